@@ -0,0 +1,202 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "ActiveDemandStatistics.h"
+#include <algorithm>
+
+uint64_t ActiveDemandStatistics::MonotonicQueue::Front() const
+{
+	return items[head];
+}
+
+uint64_t ActiveDemandStatistics::MonotonicQueue::Back() const
+{
+	return items[(head + size - 1) % kWindowSize];
+}
+
+void ActiveDemandStatistics::MonotonicQueue::PopFront()
+{
+	head = (head + 1) % kWindowSize;
+	size--;
+}
+
+void ActiveDemandStatistics::MonotonicQueue::PopBack()
+{
+	size--;
+}
+
+void ActiveDemandStatistics::MonotonicQueue::PushBack(uint64_t sequence)
+{
+	items[(head + size) % kWindowSize] = sequence;
+	size++;
+}
+
+ActiveDemandStatistics::ActiveDemandStatistics()
+{
+	Reset();
+}
+
+void ActiveDemandStatistics::Reset()
+{
+	samples = {};
+	sampleCount = 0;
+	baseTime = 0;
+	ema = 0.0;
+	minQueue = {};
+	maxQueue = {};
+	sumX = 0.0;
+	sumY = 0.0;
+	sumXX = 0.0;
+	sumXY = 0.0;
+}
+
+void ActiveDemandStatistics::AddSample(int64_t time, float value, double emaSmoothing)
+{
+	const uint64_t sequence = sampleCount;
+
+	if (sequence == 0)
+	{
+		baseTime = time;
+		ema = value;
+	}
+	else
+	{
+		ema += emaSmoothing * (static_cast<double>(value) - ema);
+	}
+
+	if (sequence >= kWindowSize)
+	{
+		// Remove the sample that is leaving the window.
+		const uint64_t evicted = sequence - kWindowSize;
+		const Sample& oldSample = GetSample(evicted);
+
+		const double x = static_cast<double>(oldSample.time - baseTime);
+		const double y = oldSample.value;
+
+		sumX -= x;
+		sumY -= y;
+		sumXX -= x * x;
+		sumXY -= x * y;
+
+		if (minQueue.size > 0 && minQueue.Front() == evicted)
+		{
+			minQueue.PopFront();
+		}
+
+		if (maxQueue.size > 0 && maxQueue.Front() == evicted)
+		{
+			maxQueue.PopFront();
+		}
+	}
+
+	samples[sequence % kWindowSize] = Sample{ time, value };
+	sampleCount++;
+
+	const double x = static_cast<double>(time - baseTime);
+	const double y = value;
+
+	sumX += x;
+	sumY += y;
+	sumXX += x * x;
+	sumXY += x * y;
+
+	// The values that can no longer be the window minimum or maximum are removed
+	// from the back of the queues, each sample is pushed and popped at most once.
+	while (minQueue.size > 0 && GetSample(minQueue.Back()).value >= value)
+	{
+		minQueue.PopBack();
+	}
+
+	minQueue.PushBack(sequence);
+
+	while (maxQueue.size > 0 && GetSample(maxQueue.Back()).value <= value)
+	{
+		maxQueue.PopBack();
+	}
+
+	maxQueue.PushBack(sequence);
+
+	// The running sums are recomputed once per window to discard the rounding
+	// errors of the subtractions and keep the x values small, this keeps the cost
+	// amortized constant.
+	if ((sampleCount % kWindowSize) == 0)
+	{
+		RecomputeSums();
+	}
+}
+
+uint64_t ActiveDemandStatistics::GetSampleCount() const
+{
+	return sampleCount;
+}
+
+double ActiveDemandStatistics::GetEma() const
+{
+	return ema;
+}
+
+float ActiveDemandStatistics::GetMin() const
+{
+	return minQueue.size > 0 ? GetSample(minQueue.Front()).value : 0.0f;
+}
+
+float ActiveDemandStatistics::GetMax() const
+{
+	return maxQueue.size > 0 ? GetSample(maxQueue.Front()).value : 0.0f;
+}
+
+double ActiveDemandStatistics::GetSlope() const
+{
+	const double n = static_cast<double>(std::min<uint64_t>(sampleCount, kWindowSize));
+	const double denominator = (n * sumXX) - (sumX * sumX);
+
+	// The slope is undefined when all of the samples have the same time.
+	if (n < 2.0 || denominator <= 0.0)
+	{
+		return 0.0;
+	}
+
+	return ((n * sumXY) - (sumX * sumY)) / denominator;
+}
+
+const ActiveDemandStatistics::Sample& ActiveDemandStatistics::GetSample(uint64_t sequence) const
+{
+	return samples[sequence % kWindowSize];
+}
+
+void ActiveDemandStatistics::RecomputeSums()
+{
+	sumX = 0.0;
+	sumY = 0.0;
+	sumXX = 0.0;
+	sumXY = 0.0;
+
+	const uint64_t first = sampleCount > kWindowSize ? sampleCount - kWindowSize : 0;
+
+	// The slope does not depend on the origin of the x values. Measuring them from the
+	// oldest sample keeps n * sumXX and sumX * sumX close to the size of the window's
+	// time span, so their difference does not lose precision as the times grow.
+	baseTime = GetSample(first).time;
+
+	for (uint64_t sequence = first; sequence < sampleCount; sequence++)
+	{
+		const Sample& sample = GetSample(sequence);
+
+		const double x = static_cast<double>(sample.time - baseTime);
+		const double y = sample.value;
+
+		sumX += x;
+		sumY += y;
+		sumXX += x * x;
+		sumXY += x * y;
+	}
+}
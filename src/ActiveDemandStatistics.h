@@ -0,0 +1,102 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Smoothed statistics over the recent active demand samples of a demand group.
+ *
+ * All storage is part of the object, adding a sample does not allocate memory and
+ * takes amortized constant time.
+ */
+class ActiveDemandStatistics
+{
+public:
+	// The number of samples that the windowed statistics cover.
+	static constexpr size_t kWindowSize = 64;
+
+	ActiveDemandStatistics();
+
+	void Reset();
+
+	/**
+	 * @brief Adds a sample, the oldest sample leaves the window when it is full.
+	 * @param time The simulation time of the sample.
+	 * @param value The active demand value.
+	 * @param emaSmoothing The weight of the new value in the exponential moving average.
+	 */
+	void AddSample(int64_t time, float value, double emaSmoothing);
+
+	uint64_t GetSampleCount() const;
+
+	/**
+	 * @brief Gets the exponential moving average of all samples.
+	 */
+	double GetEma() const;
+
+	/**
+	 * @brief Gets the smallest value in the window.
+	 */
+	float GetMin() const;
+
+	/**
+	 * @brief Gets the largest value in the window.
+	 */
+	float GetMax() const;
+
+	/**
+	 * @brief Gets the least-squares slope of the values in the window, in units per simulation time unit.
+	 */
+	double GetSlope() const;
+
+private:
+	// A double-ended queue of sample sequence numbers in a fixed-size array.
+	// The values of the samples are monotonic from front to back.
+	struct MonotonicQueue
+	{
+		std::array<uint64_t, kWindowSize> items;
+		size_t head;
+		size_t size;
+
+		uint64_t Front() const;
+		uint64_t Back() const;
+		void PopFront();
+		void PopBack();
+		void PushBack(uint64_t sequence);
+	};
+
+	struct Sample
+	{
+		int64_t time;
+		float value;
+	};
+
+	const Sample& GetSample(uint64_t sequence) const;
+	void RecomputeSums();
+
+	std::array<Sample, kWindowSize> samples;
+	uint64_t sampleCount;
+	// The sample times are made relative to this time to preserve precision, it is
+	// moved to the oldest sample in the window when the running sums are recomputed.
+	int64_t baseTime;
+	double ema;
+	MonotonicQueue minQueue;
+	MonotonicQueue maxQueue;
+	// The running sums of the samples in the window for the least-squares fit.
+	double sumX;
+	double sumY;
+	double sumXX;
+	double sumXY;
+};
@@ -0,0 +1,311 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "BuildingCensus.h"
+#include "cISC4Lot.h"
+#include "cISC4LotManager.h"
+#include "cISC4Occupant.h"
+#include "cISC4OccupantFilter.h"
+#include "cISC4OccupantManager.h"
+#include <algorithm>
+
+namespace
+{
+	constexpr uint32_t kBuildingOccupantType = 0x278128A0;
+
+	// Only includes the building occupants when the census scans the city.
+	class BuildingOccupantFilter final : public cISC4OccupantFilter
+	{
+	public:
+		BuildingOccupantFilter() : refCount(0)
+		{
+		}
+
+		bool QueryInterface(uint32_t riid, void** ppvObj) override
+		{
+			if (riid == GZIID_cIGZUnknown)
+			{
+				*ppvObj = static_cast<cIGZUnknown*>(this);
+				AddRef();
+
+				return true;
+			}
+
+			return false;
+		}
+
+		uint32_t AddRef() override
+		{
+			return ++refCount;
+		}
+
+		uint32_t Release() override
+		{
+			if (refCount > 0)
+			{
+				--refCount;
+			}
+
+			return refCount;
+		}
+
+		bool IsOccupantIncluded(cISC4Occupant* pOccupant) override
+		{
+			return true;
+		}
+
+		bool IsOccupantTypeIncluded(uint32_t dwType) override
+		{
+			return dwType == kBuildingOccupantType;
+		}
+
+		bool IsPropertyHolderIncluded(cISCPropertyHolder* pProperties) override
+		{
+			return true;
+		}
+
+	private:
+		uint32_t refCount;
+	};
+
+	bool IsBuilding(cISC4Occupant* pOccupant)
+	{
+		return pOccupant && static_cast<uint32_t>(pOccupant->GetType()) == kBuildingOccupantType;
+	}
+}
+
+BuildingCensus::BuildingCensus()
+	: pLotManager(nullptr),
+	  records(),
+	  recordIndexes(),
+	  insertedBuildings(),
+	  groupTotals{},
+	  refreshCursor(0)
+{
+}
+
+void BuildingCensus::Initialize(cISC4LotManager* pLotManager, cISC4OccupantManager* pOccupantManager)
+{
+	Shutdown();
+
+	if (pLotManager && pOccupantManager)
+	{
+		this->pLotManager = pLotManager;
+
+		BuildingOccupantFilter filter;
+
+		// The SDK does not name the cell bound parameters, null bounds are expected to
+		// cover the whole city. The caller logs the building count next to the lot count.
+		pOccupantManager->IterateOccupants(&AddOccupantCallback, this, nullptr, nullptr, &filter);
+	}
+}
+
+void BuildingCensus::Shutdown()
+{
+	for (const BuildingRecord& record : records)
+	{
+		record.pOccupant->Release();
+	}
+
+	pLotManager = nullptr;
+	records.clear();
+	recordIndexes.clear();
+	insertedBuildings.clear();
+	groupTotals = {};
+	refreshCursor = 0;
+}
+
+bool BuildingCensus::IsInitialized() const
+{
+	return pLotManager != nullptr;
+}
+
+bool BuildingCensus::OccupantInserted(cISC4Occupant* pOccupant)
+{
+	if (!pLotManager || !IsBuilding(pOccupant) || recordIndexes.contains(pOccupant))
+	{
+		return false;
+	}
+
+	AddBuilding(pOccupant);
+	insertedBuildings.push_back(pOccupant);
+	return true;
+}
+
+bool BuildingCensus::OccupantRemoved(cISC4Occupant* pOccupant)
+{
+	if (!pLotManager || !pOccupant)
+	{
+		return false;
+	}
+
+	const auto it = recordIndexes.find(pOccupant);
+
+	if (it == recordIndexes.end())
+	{
+		return false;
+	}
+
+	const uint32_t index = it->second;
+	recordIndexes.erase(it);
+
+	SubtractRecordTotals(records[index]);
+
+	const uint32_t lastIndex = static_cast<uint32_t>(records.size() - 1);
+
+	if (index != lastIndex)
+	{
+		records[index] = records[lastIndex];
+		recordIndexes[records[index].pOccupant] = index;
+	}
+
+	records.pop_back();
+	pOccupant->Release();
+
+	return true;
+}
+
+bool BuildingCensus::RefreshBuildings(size_t count)
+{
+	bool changed = false;
+
+	if (pLotManager && !records.empty())
+	{
+		for (cISC4Occupant* pOccupant : insertedBuildings)
+		{
+			// The building may have been removed after it was inserted.
+			const auto it = recordIndexes.find(pOccupant);
+
+			if (it != recordIndexes.end() && RefreshBuilding(records[it->second]))
+			{
+				changed = true;
+			}
+		}
+
+		const size_t refreshCount = std::min(count, records.size());
+
+		for (size_t i = 0; i < refreshCount; i++)
+		{
+			if (refreshCursor >= records.size())
+			{
+				refreshCursor = 0;
+			}
+
+			if (RefreshBuilding(records[refreshCursor++]))
+			{
+				changed = true;
+			}
+		}
+	}
+
+	insertedBuildings.clear();
+
+	return changed;
+}
+
+size_t BuildingCensus::GetBuildingCount() const
+{
+	return records.size();
+}
+
+const std::array<BuildingCensusGroupTotals, DemandVariables::Count>& BuildingCensus::GetGroupTotals() const
+{
+	return groupTotals;
+}
+
+bool BuildingCensus::AddOccupantCallback(cISC4Occupant* pOccupant, void* pContext)
+{
+	BuildingCensus* pCensus = static_cast<BuildingCensus*>(pContext);
+
+	if (IsBuilding(pOccupant) && !pCensus->recordIndexes.contains(pOccupant))
+	{
+		pCensus->AddBuilding(pOccupant);
+	}
+
+	return true;
+}
+
+void BuildingCensus::AddBuilding(cISC4Occupant* pOccupant)
+{
+	BuildingRecord record{};
+	record.pOccupant = pOccupant;
+	pOccupant->AddRef();
+
+	// The building may not be attached to its lot yet when the occupant is inserted,
+	// in that case its values are read by the next refresh.
+	ReadBuilding(record);
+	AddRecordTotals(record);
+
+	recordIndexes.emplace(pOccupant, static_cast<uint32_t>(records.size()));
+	records.push_back(record);
+}
+
+void BuildingCensus::ReadBuilding(BuildingRecord& record) const
+{
+	cISC4Lot* pLot = pLotManager->GetOccupantLot(record.pOccupant);
+
+	if (pLot)
+	{
+		for (size_t i = 0; i < DemandVariables::Count; i++)
+		{
+			const uint32_t developerType = DemandVariables::Table[i].demandID;
+
+			record.capacity[i] = pLot->GetCapacity(developerType, false);
+			record.occupancy[i] = pLot->GetPopulation(developerType);
+		}
+	}
+	else
+	{
+		record.capacity.fill(0);
+		record.occupancy.fill(0);
+	}
+}
+
+bool BuildingCensus::RefreshBuilding(BuildingRecord& record)
+{
+	BuildingRecord current = record;
+	ReadBuilding(current);
+
+	if (current.capacity != record.capacity || current.occupancy != record.occupancy)
+	{
+		SubtractRecordTotals(record);
+		record = current;
+		AddRecordTotals(record);
+		return true;
+	}
+
+	return false;
+}
+
+void BuildingCensus::AddRecordTotals(const BuildingRecord& record)
+{
+	for (size_t i = 0; i < DemandVariables::Count; i++)
+	{
+		BuildingCensusGroupTotals& totals = groupTotals[i];
+
+		totals.buildingCount += record.capacity[i] != 0 ? 1 : 0;
+		totals.capacity += record.capacity[i];
+		totals.occupancy += record.occupancy[i];
+	}
+}
+
+void BuildingCensus::SubtractRecordTotals(const BuildingRecord& record)
+{
+	for (size_t i = 0; i < DemandVariables::Count; i++)
+	{
+		BuildingCensusGroupTotals& totals = groupTotals[i];
+
+		totals.buildingCount -= record.capacity[i] != 0 ? 1 : 0;
+		totals.capacity -= record.capacity[i];
+		totals.occupancy -= record.occupancy[i];
+	}
+}
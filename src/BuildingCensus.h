@@ -0,0 +1,117 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "DemandVariables.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class cISC4LotManager;
+class cISC4Occupant;
+class cISC4OccupantManager;
+
+struct BuildingCensusGroupTotals
+{
+	// The number of buildings that have capacity for the group.
+	uint32_t buildingCount;
+	// The number of residents or jobs that the buildings can hold.
+	uint32_t capacity;
+	// The number of residents or jobs that the buildings currently hold.
+	uint32_t occupancy;
+};
+
+/**
+ * @brief Counts the buildings, capacity and occupancy of each DemandVariables group.
+ *
+ * The census scans the city's buildings once when the city is loaded, after that it
+ * is kept current by the occupant inserted and removed messages. Each building's
+ * contribution is stored so that it can be subtracted in constant time when the
+ * building is removed.
+ *
+ * The census holds a reference to each building occupant, the pointer of a building
+ * that was removed without a message can not be reused by a new building.
+ */
+class BuildingCensus
+{
+public:
+	BuildingCensus();
+
+	/**
+	 * @brief Scans all of the buildings in the city.
+	 */
+	void Initialize(cISC4LotManager* pLotManager, cISC4OccupantManager* pOccupantManager);
+
+	void Shutdown();
+
+	bool IsInitialized() const;
+
+	/**
+	 * @brief Adds the occupant to the census if it is a building.
+	 * @return True if the group totals changed; otherwise, false.
+	 */
+	bool OccupantInserted(cISC4Occupant* pOccupant);
+
+	/**
+	 * @brief Removes the occupant from the census if it is a building.
+	 * @return True if the group totals changed; otherwise, false.
+	 */
+	bool OccupantRemoved(cISC4Occupant* pOccupant);
+
+	/**
+	 * @brief Reads the current values of the next buildings in the census.
+	 *
+	 * The occupancy of a building changes without a message, so the buildings are
+	 * re-read in small batches that cycle through the whole census. The buildings that
+	 * were inserted since the last call are always re-read, a building can be inserted
+	 * before it is attached to its lot.
+	 *
+	 * @param count The maximum number of buildings to read.
+	 * @return True if the group totals changed; otherwise, false.
+	 */
+	bool RefreshBuildings(size_t count);
+
+	size_t GetBuildingCount() const;
+
+	const std::array<BuildingCensusGroupTotals, DemandVariables::Count>& GetGroupTotals() const;
+
+private:
+	struct BuildingRecord
+	{
+		cISC4Occupant* pOccupant;
+		std::array<uint16_t, DemandVariables::Count> capacity;
+		std::array<uint16_t, DemandVariables::Count> occupancy;
+	};
+
+	static bool AddOccupantCallback(cISC4Occupant* pOccupant, void* pContext);
+
+	void AddBuilding(cISC4Occupant* pOccupant);
+
+	void ReadBuilding(BuildingRecord& record) const;
+
+	bool RefreshBuilding(BuildingRecord& record);
+
+	void AddRecordTotals(const BuildingRecord& record);
+
+	void SubtractRecordTotals(const BuildingRecord& record);
+
+	cISC4LotManager* pLotManager;
+	// The records are stored in a dense array, a removed record is replaced by the last one.
+	std::vector<BuildingRecord> records;
+	std::unordered_map<cISC4Occupant*, uint32_t> recordIndexes;
+	// The buildings that were inserted since the last refresh.
+	std::vector<cISC4Occupant*> insertedBuildings;
+	std::array<BuildingCensusGroupTotals, DemandVariables::Count> groupTotals;
+	size_t refreshCursor;
+};
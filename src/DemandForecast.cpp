@@ -0,0 +1,98 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "DemandForecast.h"
+#include <cmath>
+
+DemandForecast::DemandForecast(const DemandForecastParameters& parameters)
+	: parameters(parameters),
+	  state()
+{
+}
+
+void DemandForecast::Reset()
+{
+	state = {};
+}
+
+void DemandForecast::Update(const std::array<float, DemandVariables::Count>& values)
+{
+	constexpr size_t Count = DemandVariables::Count;
+
+	if (state.sampleCount == 0)
+	{
+		// The first month initializes the level, the trend and seasonal
+		// components start at zero and are learned from the later months.
+		state.level = values;
+		state.sampleCount = 1;
+		return;
+	}
+
+	const float alpha = parameters.levelSmoothing;
+	const float beta = parameters.trendSmoothing;
+	const float gamma = parameters.seasonalSmoothing;
+	const float errorSmoothing = parameters.errorSmoothing;
+
+	std::array<float, Count>& seasonal = state.seasonal[state.sampleCount % DemandForecastState::kSeasonLength];
+
+	// The loop bodies have no branches or dependencies between the groups,
+	// the compiler updates several groups at a time with SIMD instructions.
+	for (size_t i = 0; i < Count; i++)
+	{
+		const float previousLevel = state.level[i];
+		const float previousTrend = state.trend[i];
+		const float value = values[i];
+
+		const float error = value - (previousLevel + previousTrend + seasonal[i]);
+		state.meanSquaredError[i] += errorSmoothing * ((error * error) - state.meanSquaredError[i]);
+
+		const float level = (alpha * (value - seasonal[i])) + ((1.0f - alpha) * (previousLevel + previousTrend));
+
+		state.trend[i] = (beta * (level - previousLevel)) + ((1.0f - beta) * previousTrend);
+		seasonal[i] = (gamma * (value - level)) + ((1.0f - gamma) * seasonal[i]);
+		state.level[i] = level;
+	}
+
+	state.sampleCount++;
+}
+
+bool DemandForecast::HasForecast() const
+{
+	return state.sampleCount > 1;
+}
+
+float DemandForecast::GetForecast(size_t slot, uint32_t monthsAhead) const
+{
+	// The season of the month that is monthsAhead after the last update.
+	const size_t season = (state.sampleCount - 1 + monthsAhead) % DemandForecastState::kSeasonLength;
+
+	return state.level[slot]
+		+ (static_cast<float>(monthsAhead) * state.trend[slot])
+		+ state.seasonal[season][slot];
+}
+
+float DemandForecast::GetForecastDeviation(size_t slot, uint32_t monthsAhead) const
+{
+	// The one-step error is scaled by the square root of the horizon, this treats the
+	// monthly errors as independent and is an approximation of the true interval.
+	return std::sqrt(state.meanSquaredError[slot] * static_cast<float>(monthsAhead));
+}
+
+const DemandForecastState& DemandForecast::GetState() const
+{
+	return state;
+}
+
+void DemandForecast::SetState(const DemandForecastState& newState)
+{
+	state = newState;
+}
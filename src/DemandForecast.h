@@ -0,0 +1,85 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "DemandVariables.h"
+#include <array>
+#include <cstdint>
+
+/**
+ * @brief The state of the demand forecast models for every demand group.
+ *
+ * The values of each model component are stored in one array per component, so that the
+ * monthly update runs over contiguous arrays of the same type.
+ */
+struct DemandForecastState
+{
+	static constexpr size_t kSeasonLength = 12;
+
+	uint32_t sampleCount;
+	std::array<float, DemandVariables::Count> level;
+	std::array<float, DemandVariables::Count> trend;
+	// The smoothed squared one-step forecast error.
+	std::array<float, DemandVariables::Count> meanSquaredError;
+	std::array<std::array<float, DemandVariables::Count>, kSeasonLength> seasonal;
+};
+
+struct DemandForecastParameters
+{
+	float levelSmoothing;
+	float trendSmoothing;
+	float seasonalSmoothing;
+	float errorSmoothing;
+};
+
+/**
+ * @brief An additive Holt-Winters model of the monthly demand of each demand group.
+ *
+ * Each update takes constant time, regardless of how many months the model has seen.
+ */
+class DemandForecast
+{
+public:
+	explicit DemandForecast(const DemandForecastParameters& parameters);
+
+	void Reset();
+
+	/**
+	 * @brief Updates the models with the demand values of a new month.
+	 * @param values The demand of each demand group.
+	 */
+	void Update(const std::array<float, DemandVariables::Count>& values);
+
+	bool HasForecast() const;
+
+	/**
+	 * @brief Gets the predicted demand of a group.
+	 * @param slot The DemandVariables table slot.
+	 * @param monthsAhead The number of months after the last update.
+	 */
+	float GetForecast(size_t slot, uint32_t monthsAhead) const;
+
+	/**
+	 * @brief Gets the approximate standard deviation of the forecast error.
+	 * @param slot The DemandVariables table slot.
+	 * @param monthsAhead The number of months after the last update.
+	 */
+	float GetForecastDeviation(size_t slot, uint32_t monthsAhead) const;
+
+	const DemandForecastState& GetState() const;
+
+	void SetState(const DemandForecastState& state);
+
+private:
+	DemandForecastParameters parameters;
+	DemandForecastState state;
+};
@@ -0,0 +1,321 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "DemandHistory.h"
+#include "VarintEncoding.h"
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+#include <system_error>
+#include <tuple>
+#include <vector>
+
+namespace
+{
+	constexpr std::string_view HistoryFileExtension = ".SC4MoreDemandInfo.history";
+
+	constexpr uint32_t kHistoryFileSignature = 0x5348444D; // MDHS
+	constexpr uint32_t kHistoryFileVersion = 3;
+
+	// The file consists of a header followed by the encoded columns.
+	// Each column holds the values of one sample field, stored as zigzag encoded
+	// deltas from the previous sample.
+	// The demand values are stored exactly, as their float bit patterns mapped to integers
+	// that sort in the same order as the floats. The delta of two adjacent months is their
+	// distance in units in the last place, a change of one unit in a value in the thousands
+	// is a delta of about 4096 and is encoded in two bytes.
+	// All values are stored in little endian byte order.
+
+	struct HistoryFileHeader
+	{
+		uint32_t signature;
+		uint32_t version;
+		uint32_t citySerialNumber;
+		uint32_t sampleCount;
+		uint32_t columnCount;
+		uint32_t dataLength;
+		uint32_t dataChecksum;
+		uint32_t headerChecksum;
+	};
+
+	static_assert(sizeof(HistoryFileHeader) == 32);
+
+	constexpr size_t kDemandColumnCount = std::tuple_size_v<decltype(DemandHistorySample::demand)>;
+	constexpr size_t kActiveDemandColumnCount = std::tuple_size_v<decltype(DemandHistorySample::activeDemand)>;
+	constexpr size_t kTaxIncomeColumnCount = std::tuple_size_v<decltype(DemandHistorySample::taxIncome)>;
+	constexpr size_t kRegionPopulationColumnCount = std::tuple_size_v<decltype(DemandHistorySample::regionPopulation)>;
+
+	constexpr size_t kDemandFirstColumn = 1;
+	constexpr size_t kActiveDemandFirstColumn = kDemandFirstColumn + kDemandColumnCount;
+	constexpr size_t kTaxIncomeFirstColumn = kActiveDemandFirstColumn + kActiveDemandColumnCount;
+	constexpr size_t kRegionPopulationFirstColumn = kTaxIncomeFirstColumn + kTaxIncomeColumnCount;
+	constexpr size_t kColumnCount = kRegionPopulationFirstColumn + kRegionPopulationColumnCount;
+
+	// The negative values have their magnitude bits inverted, so that the integers
+	// increase with the float values. The mapping is its own inverse.
+	int32_t FlipNegativeFloatBits(int32_t bits)
+	{
+		return bits ^ ((bits >> 31) & 0x7FFFFFFF);
+	}
+
+	int64_t FloatToColumnValue(float value)
+	{
+		return FlipNegativeFloatBits(std::bit_cast<int32_t>(value));
+	}
+
+	float ColumnValueToFloat(int64_t value)
+	{
+		return std::bit_cast<float>(FlipNegativeFloatBits(static_cast<int32_t>(value)));
+	}
+
+	int64_t GetColumnValue(const DemandHistorySample& sample, size_t column)
+	{
+		if (column < kDemandFirstColumn)
+		{
+			return sample.simDate;
+		}
+		else if (column < kActiveDemandFirstColumn)
+		{
+			return FloatToColumnValue(sample.demand[column - kDemandFirstColumn]);
+		}
+		else if (column < kTaxIncomeFirstColumn)
+		{
+			return FloatToColumnValue(sample.activeDemand[column - kActiveDemandFirstColumn]);
+		}
+		else if (column < kRegionPopulationFirstColumn)
+		{
+			return sample.taxIncome[column - kTaxIncomeFirstColumn];
+		}
+		else
+		{
+			return sample.regionPopulation[column - kRegionPopulationFirstColumn];
+		}
+	}
+
+	void SetColumnValue(DemandHistorySample& sample, size_t column, int64_t value)
+	{
+		if (column < kDemandFirstColumn)
+		{
+			sample.simDate = static_cast<int32_t>(value);
+		}
+		else if (column < kActiveDemandFirstColumn)
+		{
+			sample.demand[column - kDemandFirstColumn] = ColumnValueToFloat(value);
+		}
+		else if (column < kTaxIncomeFirstColumn)
+		{
+			sample.activeDemand[column - kActiveDemandFirstColumn] = ColumnValueToFloat(value);
+		}
+		else if (column < kRegionPopulationFirstColumn)
+		{
+			sample.taxIncome[column - kTaxIncomeFirstColumn] = value;
+		}
+		else
+		{
+			sample.regionPopulation[column - kRegionPopulationFirstColumn] = value;
+		}
+	}
+
+	// The 32-bit FNV-1a hash.
+	uint32_t ComputeChecksum(const void* data, size_t length)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+		uint32_t hash = 0x811C9DC5;
+
+		for (size_t i = 0; i < length; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 0x01000193;
+		}
+
+		return hash;
+	}
+
+	uint32_t ComputeHeaderChecksum(const HistoryFileHeader& header)
+	{
+		return ComputeChecksum(&header, offsetof(HistoryFileHeader, headerChecksum));
+	}
+}
+
+DemandHistory::DemandHistory()
+	: samples()
+{
+}
+
+std::filesystem::path DemandHistory::GetHistoryFilePath(const std::filesystem::path& citySaveFilePath)
+{
+	std::filesystem::path path;
+
+	if (!citySaveFilePath.empty() && citySaveFilePath.is_absolute())
+	{
+		path = citySaveFilePath;
+		path += HistoryFileExtension;
+	}
+
+	return path;
+}
+
+void DemandHistory::Clear()
+{
+	samples.clear();
+}
+
+void DemandHistory::AddSample(const DemandHistorySample& sample)
+{
+	if (samples.size() == kMaxSampleCount)
+	{
+		samples.pop_front();
+	}
+
+	samples.push_back(sample);
+}
+
+size_t DemandHistory::GetSampleCount() const
+{
+	return samples.size();
+}
+
+const DemandHistorySample& DemandHistory::GetSample(size_t index) const
+{
+	return samples[index];
+}
+
+bool DemandHistory::Load(const std::filesystem::path& path, uint32_t citySerialNumber, int32_t currentSimDate)
+{
+	samples.clear();
+
+	std::ifstream stream(path, std::ifstream::in | std::ifstream::binary);
+
+	if (!stream)
+	{
+		return false;
+	}
+
+	HistoryFileHeader header{};
+
+	if (!stream.read(reinterpret_cast<char*>(&header), sizeof(header))
+		|| header.signature != kHistoryFileSignature
+		|| header.version != kHistoryFileVersion
+		|| header.headerChecksum != ComputeHeaderChecksum(header)
+		|| header.citySerialNumber != citySerialNumber
+		|| header.columnCount != kColumnCount
+		|| header.sampleCount > kMaxSampleCount
+		|| header.dataLength > header.sampleCount * kColumnCount * 10)
+	{
+		return false;
+	}
+
+	std::vector<uint8_t> data(header.dataLength);
+
+	if (!stream.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()))
+		|| header.dataChecksum != ComputeChecksum(data.data(), data.size()))
+	{
+		return false;
+	}
+
+	std::deque<DemandHistorySample> decodedSamples(header.sampleCount);
+	size_t position = 0;
+
+	for (size_t column = 0; column < kColumnCount; column++)
+	{
+		int64_t value = 0;
+
+		for (DemandHistorySample& sample : decodedSamples)
+		{
+			uint64_t encoded = 0;
+
+			if (!VarintEncoding::Read(data.data(), data.size(), position, encoded))
+			{
+				return false;
+			}
+
+			value += VarintEncoding::ZigZagDecode(encoded);
+			SetColumnValue(sample, column, value);
+		}
+	}
+
+	// A history that was saved after the save file that is being loaded contains
+	// months that have not happened yet, e.g. when the player quit without saving.
+	while (!decodedSamples.empty() && decodedSamples.back().simDate > currentSimDate)
+	{
+		decodedSamples.pop_back();
+	}
+
+	samples = std::move(decodedSamples);
+
+	return true;
+}
+
+bool DemandHistory::Save(const std::filesystem::path& path, uint32_t citySerialNumber) const
+{
+	std::vector<uint8_t> data;
+	data.reserve(samples.size() * kColumnCount * 2);
+
+	for (size_t column = 0; column < kColumnCount; column++)
+	{
+		int64_t previousValue = 0;
+
+		for (const DemandHistorySample& sample : samples)
+		{
+			const int64_t value = GetColumnValue(sample, column);
+
+			VarintEncoding::Write(data, VarintEncoding::ZigZagEncode(value - previousValue));
+			previousValue = value;
+		}
+	}
+
+	HistoryFileHeader header{};
+	header.signature = kHistoryFileSignature;
+	header.version = kHistoryFileVersion;
+	header.citySerialNumber = citySerialNumber;
+	header.sampleCount = static_cast<uint32_t>(samples.size());
+	header.columnCount = static_cast<uint32_t>(kColumnCount);
+	header.dataLength = static_cast<uint32_t>(data.size());
+	header.dataChecksum = ComputeChecksum(data.data(), data.size());
+	header.headerChecksum = ComputeHeaderChecksum(header);
+
+	// The data is written to a temporary file that replaces the existing history
+	// file, this prevents a partially written file from being loaded.
+	std::filesystem::path tempPath = path;
+	tempPath += ".tmp";
+
+	{
+		std::ofstream stream(tempPath, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+
+		if (!stream)
+		{
+			return false;
+		}
+
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		stream.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+
+		if (!stream)
+		{
+			return false;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tempPath, path, ec);
+
+	if (ec)
+	{
+		std::filesystem::remove(tempPath, ec);
+		return false;
+	}
+
+	return true;
+}
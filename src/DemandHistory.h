@@ -0,0 +1,112 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "DemandVariables.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+
+/**
+ * @brief The values that are recorded at the start of each simulation month.
+ */
+struct DemandHistorySample
+{
+	// The value of cISC4Simulator::GetSimDateNumber.
+	int32_t simDate;
+	std::array<float, DemandVariables::Count> demand;
+	std::array<float, DemandVariables::Count> activeDemand;
+	// The values of cISC4BudgetSimulator::GetTaxIncome for the 12 RCI subgroups.
+	std::array<int64_t, 12> taxIncome;
+	// The regional populations of the 12 RCI subgroups, in PopulationTotals order.
+	std::array<int64_t, 12> regionPopulation;
+};
+
+/**
+ * @brief The monthly history of a city's demand, tax income and regional population values.
+ *
+ * The history is stored in a file next to the city's save file, it is written when the
+ * city is saved and read when the city is loaded. The SDK has the serializable and
+ * DB segment stream interfaces, but it only forward-declares cIGZPersistDBSegment,
+ * so the plugin cannot add its own record to the save file.
+ */
+class DemandHistory
+{
+public:
+	// One hundred years of monthly samples.
+	static constexpr size_t kMaxSampleCount = 1200;
+
+	DemandHistory();
+
+	static std::filesystem::path GetHistoryFilePath(const std::filesystem::path& citySaveFilePath);
+
+	void Clear();
+
+	/**
+	 * @brief Appends a sample, the oldest sample is removed when the history is full.
+	 */
+	void AddSample(const DemandHistorySample& sample);
+
+	size_t GetSampleCount() const;
+
+	const DemandHistorySample& GetSample(size_t index) const;
+
+	/**
+	 * @brief Gets the average of a value over the most recent samples.
+	 * @param member The sample member to average.
+	 * @param index The index of the value within the member.
+	 * @param monthCount The number of months to average.
+	 * @return The average, or 0 if there are no samples.
+	 */
+	template <typename T, size_t N>
+	double GetAverage(std::array<T, N> DemandHistorySample::* member, size_t index, size_t monthCount) const
+	{
+		const size_t count = std::min(monthCount, samples.size());
+
+		if (count == 0)
+		{
+			return 0.0;
+		}
+
+		double sum = 0.0;
+
+		for (size_t i = samples.size() - count; i < samples.size(); i++)
+		{
+			sum += static_cast<double>((samples[i].*member)[index]);
+		}
+
+		return sum / static_cast<double>(count);
+	}
+
+	/**
+	 * @brief Reads the history from the specified file.
+	 * @param path The history file path.
+	 * @param citySerialNumber The serial number of the city that is being loaded.
+	 * @param currentSimDate The current simulation date. Samples that are newer than this
+	 * date are discarded, they were recorded after the save that is being loaded.
+	 * @return True if the history was read; otherwise, false.
+	 */
+	bool Load(const std::filesystem::path& path, uint32_t citySerialNumber, int32_t currentSimDate);
+
+	/**
+	 * @brief Writes the history to the specified file.
+	 * @param path The history file path.
+	 * @param citySerialNumber The serial number of the city.
+	 * @return True if the file was written; otherwise, false.
+	 */
+	bool Save(const std::filesystem::path& path, uint32_t citySerialNumber) const;
+
+private:
+	std::deque<DemandHistorySample> samples;
+};
@@ -0,0 +1,126 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "DemandSnapshot.h"
+#include "Instrumentation.h"
+#include "cISC4Demand.h"
+#include "cISC4DemandSimulator.h"
+#include "SC4Percentage.h"
+#include <bit>
+
+namespace
+{
+	constexpr uint32_t kTotalsDemandIndex = 0x20000;
+
+	constexpr uint32_t kAllSlots = DemandVariables::Count == 32
+		? UINT32_MAX
+		: (1U << DemandVariables::Count) - 1;
+
+	void ReadDemandValues(const cISC4Demand* pDemand, DemandValues& values)
+	{
+		values.supply = pDemand->QuerySupplyValue();
+		values.demand = pDemand->QueryDemandValue();
+		values.newSupply = pDemand->QueryNewSupply();
+		values.newDemand = pDemand->QueryNewDemand();
+		values.activeDemand = pDemand->QueryActiveDemandValue();
+		values.activeDemandMin = pDemand->QueryActiveDemandMin();
+		values.activeDemandMax = pDemand->QueryActiveDemandMax();
+		values.economyModifier = pDemand->QueryEconomyModifier();
+		values.taxModifier = pDemand->GetTaxModifier();
+
+		const SC4Percentage* cap = pDemand->GetDemandCap();
+		values.demandCap = cap ? cap->percentage : 0.0f;
+	}
+}
+
+DemandSnapshot::DemandSnapshot()
+	: pDemandSim(nullptr),
+	  demands(),
+	  buffers(),
+	  currentBuffer(0)
+{
+}
+
+void DemandSnapshot::Attach(cISC4DemandSimulator* pDemandSim)
+{
+	Detach();
+
+	this->pDemandSim = pDemandSim;
+
+	for (size_t i = 0; i < DemandVariables::Count; i++)
+	{
+		GetDemand(i);
+	}
+}
+
+void DemandSnapshot::Detach()
+{
+	pDemandSim = nullptr;
+	demands.fill(nullptr);
+	buffers = {};
+	currentBuffer = 0;
+}
+
+void DemandSnapshot::Capture(uint32_t slots)
+{
+	const DemandSnapshotData& current = buffers[currentBuffer];
+	DemandSnapshotData& next = buffers[currentBuffer ^ 1];
+
+	// The slots that are not part of this capture keep their previous values.
+	next = current;
+	slots &= kAllSlots;
+
+	while (slots != 0)
+	{
+		const size_t slot = static_cast<size_t>(std::countr_zero(slots));
+		slots &= slots - 1;
+
+		const cISC4Demand* pDemand = GetDemand(slot);
+
+		if (pDemand)
+		{
+			ReadDemandValues(pDemand, next.groups[slot]);
+			next.validSlots |= 1U << slot;
+		}
+	}
+
+	next.sequence = current.sequence + 1;
+	currentBuffer ^= 1;
+}
+
+void DemandSnapshot::CaptureAll()
+{
+	Capture(kAllSlots);
+}
+
+const DemandSnapshotData& DemandSnapshot::GetCurrent() const
+{
+	return buffers[currentBuffer];
+}
+
+cISC4Demand* DemandSnapshot::GetDemand(size_t slot)
+{
+	cISC4Demand* pDemand = demands[slot];
+
+	// The demand simulator may not have created every demand instance when the
+	// city is initialized, so the lookup is retried until it succeeds.
+	if (!pDemand && pDemandSim)
+	{
+		pDemand = INSTRUMENT_CALL(
+			InstrumentedCallSite::GetDemand,
+			pDemandSim->GetDemand(DemandVariables::Table[slot].demandID, kTotalsDemandIndex));
+
+		demands[slot] = pDemand;
+	}
+
+	return pDemand;
+}
@@ -0,0 +1,93 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "DemandVariables.h"
+#include <array>
+#include <cstdint>
+
+class cISC4Demand;
+class cISC4DemandSimulator;
+
+/**
+ * @brief The values of a cISC4Demand instance at the time of the last capture.
+ */
+struct DemandValues
+{
+	float supply;
+	float demand;
+	float newSupply;
+	float newDemand;
+	float activeDemand;
+	float activeDemandMin;
+	float activeDemandMax;
+	float economyModifier;
+	float taxModifier;
+	// The demand cap in the range of [0, 1].
+	float demandCap;
+};
+
+/**
+ * @brief The values of every demand group in the DemandVariables table.
+ */
+struct DemandSnapshotData
+{
+	std::array<DemandValues, DemandVariables::Count> groups;
+	// A bit set of the DemandVariables table slots that have valid values.
+	uint32_t validSlots;
+	// Incremented every time a capture is published.
+	uint32_t sequence;
+};
+
+/**
+ * @brief Reads the city totals of every demand group with a single pass over the cached
+ * cISC4Demand instances, the plugin features read the values from the snapshot instead
+ * of calling into the game.
+ */
+class DemandSnapshot
+{
+public:
+	DemandSnapshot();
+
+	/**
+	 * @brief Caches the cISC4Demand instances of the city.
+	 */
+	void Attach(cISC4DemandSimulator* pDemandSim);
+
+	void Detach();
+
+	/**
+	 * @brief Reads the values of the specified table slots into the back buffer and publishes it.
+	 * @param slots A bit set of the DemandVariables table slots to read, the other slots keep
+	 * their previous values.
+	 */
+	void Capture(uint32_t slots);
+
+	/**
+	 * @brief Reads the values of all table slots.
+	 */
+	void CaptureAll();
+
+	const DemandSnapshotData& GetCurrent() const;
+
+private:
+	cISC4Demand* GetDemand(size_t slot);
+
+	cISC4DemandSimulator* pDemandSim;
+	std::array<cISC4Demand*, DemandVariables::Count> demands;
+	// The captures are written to the buffer that is not current, so that a
+	// reader always sees a complete snapshot.
+	std::array<DemandSnapshotData, 2> buffers;
+	uint32_t currentBuffer;
+
+	static_assert(DemandVariables::Count <= 32, "The valid slots do not fit in a uint32_t.");
+};
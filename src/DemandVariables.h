@@ -0,0 +1,345 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+enum class DemandVariableFlags : uint32_t
+{
+	None = 0,
+	// Publish the value of cISC4Demand::QueryActiveDemandValue.
+	ActiveDemand = 1 << 0,
+	// Publish the value of cISC4Demand::QueryDemandValue.
+	Demand = 1 << 1,
+	// Publish the value of cISC4Demand::GetDemandCap.
+	DemandCap = 1 << 2,
+};
+
+constexpr DemandVariableFlags operator|(DemandVariableFlags lhs, DemandVariableFlags rhs)
+{
+	return static_cast<DemandVariableFlags>(static_cast<uint32_t>(lhs) | static_cast<uint32_t>(rhs));
+}
+
+constexpr bool HasFlag(DemandVariableFlags flags, DemandVariableFlags flag)
+{
+	return (static_cast<uint32_t>(flags) & static_cast<uint32_t>(flag)) != 0;
+}
+
+struct DemandVariableInfo
+{
+	uint32_t demandID;
+	DemandVariableFlags flags;
+	// The variable names that SC4 will add to the Lua game table.
+	// A name is only used when the corresponding flag is set.
+	const char* activeDemandVariableName;
+	const char* demandVariableName;
+	const char* demandCapVariableName;
+	// The group name that is written to the log.
+	const char* logName;
+};
+
+namespace DemandVariables
+{
+	inline constexpr std::array<DemandVariableInfo, 12> Table =
+	{
+		DemandVariableInfo
+		{
+			0x1010,
+			DemandVariableFlags::ActiveDemand | DemandVariableFlags::Demand,
+			"g_r1_active_demand",
+			"g_r1_demand",
+			nullptr,
+			"R1",
+		},
+		DemandVariableInfo
+		{
+			0x1020,
+			DemandVariableFlags::ActiveDemand | DemandVariableFlags::Demand,
+			"g_r2_active_demand",
+			"g_r2_demand",
+			nullptr,
+			"R2",
+		},
+		DemandVariableInfo
+		{
+			0x1030,
+			DemandVariableFlags::ActiveDemand | DemandVariableFlags::Demand,
+			"g_r3_active_demand",
+			"g_r3_demand",
+			nullptr,
+			"R3",
+		},
+		DemandVariableInfo
+		{
+			0x3110,
+			DemandVariableFlags::ActiveDemand | DemandVariableFlags::Demand,
+			"g_cs1_active_demand",
+			"g_cs1_demand",
+			nullptr,
+			"cs1",
+		},
+		DemandVariableInfo
+		{
+			0x3120,
+			DemandVariableFlags::ActiveDemand | DemandVariableFlags::Demand,
+			"g_cs2_active_demand",
+			"g_cs2_demand",
+			nullptr,
+			"cs2",
+		},
+		DemandVariableInfo
+		{
+			0x3130,
+			DemandVariableFlags::ActiveDemand | DemandVariableFlags::Demand,
+			"g_cs3_active_demand",
+			"g_cs3_demand",
+			nullptr,
+			"cs3",
+		},
+		DemandVariableInfo
+		{
+			0x3320,
+			DemandVariableFlags::ActiveDemand | DemandVariableFlags::Demand,
+			"g_co2_active_demand",
+			"g_co2_demand",
+			nullptr,
+			"Co2",
+		},
+		DemandVariableInfo
+		{
+			0x3330,
+			DemandVariableFlags::ActiveDemand | DemandVariableFlags::Demand,
+			"g_co3_active_demand",
+			"g_co3_demand",
+			nullptr,
+			"Co3",
+		},
+		DemandVariableInfo
+		{
+			0x4100,
+			DemandVariableFlags::ActiveDemand | DemandVariableFlags::Demand | DemandVariableFlags::DemandCap,
+			"g_ir_active_demand",
+			"g_ir_demand",
+			"g_current_ir_cap",
+			"IR (I-Ag)",
+		},
+		DemandVariableInfo
+		{
+			0x4200,
+			DemandVariableFlags::Demand,
+			nullptr,
+			"g_id_demand",
+			nullptr,
+			"ID",
+		},
+		DemandVariableInfo
+		{
+			0x4300,
+			DemandVariableFlags::Demand,
+			nullptr,
+			"g_im_demand",
+			nullptr,
+			"IM",
+		},
+		DemandVariableInfo
+		{
+			0x4400,
+			DemandVariableFlags::Demand,
+			nullptr,
+			"g_iht_demand",
+			nullptr,
+			"IHT",
+		},
+	};
+
+	inline constexpr size_t Count = Table.size();
+	inline constexpr size_t InvalidSlot = static_cast<size_t>(-1);
+
+	namespace Detail
+	{
+		// The demand IDs are mapped to a table slot using a multiplicative hash that
+		// is searched for at compile time, a table with twice as many buckets as there
+		// are entries lets the search find a collision-free multiplier quickly.
+
+		inline constexpr uint32_t BucketCount = std::bit_ceil(static_cast<uint32_t>(Count * 2));
+		inline constexpr uint32_t BucketShift = 32 - std::countr_zero(BucketCount);
+		inline constexpr uint8_t EmptyBucket = 0xFF;
+
+		static_assert(Count < EmptyBucket, "The demand variable table is too large.");
+
+		constexpr uint32_t GetBucket(uint32_t demandID, uint32_t multiplier)
+		{
+			return (demandID * multiplier) >> BucketShift;
+		}
+
+		constexpr bool IsPerfectHash(uint32_t multiplier)
+		{
+			std::array<bool, BucketCount> used{};
+
+			for (const DemandVariableInfo& info : Table)
+			{
+				const uint32_t bucket = GetBucket(info.demandID, multiplier);
+
+				if (used[bucket])
+				{
+					return false;
+				}
+
+				used[bucket] = true;
+			}
+
+			return true;
+		}
+
+		constexpr uint32_t FindMultiplier()
+		{
+			// Start at the 32-bit golden ratio constant and step through the odd numbers.
+			for (uint32_t multiplier = 0x9E3779B1; multiplier != 0x9E3779B1 + 200000; multiplier += 2)
+			{
+				if (IsPerfectHash(multiplier))
+				{
+					return multiplier;
+				}
+			}
+
+			return 0;
+		}
+
+		inline constexpr uint32_t Multiplier = FindMultiplier();
+
+		static_assert(Multiplier != 0, "Unable to find a perfect hash for the demand IDs.");
+
+		constexpr std::array<uint8_t, BucketCount> CreateBucketTable()
+		{
+			std::array<uint8_t, BucketCount> buckets{};
+
+			for (uint8_t& item : buckets)
+			{
+				item = EmptyBucket;
+			}
+
+			for (size_t i = 0; i < Count; i++)
+			{
+				buckets[GetBucket(Table[i].demandID, Multiplier)] = static_cast<uint8_t>(i);
+			}
+
+			return buckets;
+		}
+
+		inline constexpr std::array<uint8_t, BucketCount> Buckets = CreateBucketTable();
+	}
+
+	/**
+	 * @brief Gets the table slot for the specified demand ID.
+	 * @param demandID The demand ID.
+	 * @return The table slot, or InvalidSlot if the demand ID is not in the table.
+	 */
+	constexpr size_t GetSlot(uint32_t demandID)
+	{
+		const uint8_t slot = Detail::Buckets[Detail::GetBucket(demandID, Detail::Multiplier)];
+
+		// Any value that is not in the table can still hash to an occupied bucket,
+		// so the ID stored in that slot must be checked.
+		if (slot != Detail::EmptyBucket && Table[slot].demandID == demandID)
+		{
+			return slot;
+		}
+
+		return InvalidSlot;
+	}
+
+	// The statistics of the active demand samples that are published for the groups
+	// with the ActiveDemand flag, the variable name is the active demand variable name
+	// followed by the suffix, e.g. g_cs1_active_demand_ema.
+	enum class ActiveDemandStatistic : size_t
+	{
+		Ema = 0,
+		Min,
+		Max,
+		Slope,
+		Count
+	};
+
+	inline constexpr std::array<std::string_view, static_cast<size_t>(ActiveDemandStatistic::Count)> ActiveDemandStatisticSuffixes =
+	{
+		"_ema",
+		"_min",
+		"_max",
+		"_slope",
+	};
+
+	namespace Detail
+	{
+		template <size_t NameLength, size_t SuffixLength>
+		constexpr std::array<char, NameLength + SuffixLength + 1> AppendVariableNameSuffix(std::string_view name, std::string_view suffix)
+		{
+			std::array<char, NameLength + SuffixLength + 1> result{};
+
+			for (size_t i = 0; i < NameLength; i++)
+			{
+				result[i] = name[i];
+			}
+
+			for (size_t i = 0; i < SuffixLength; i++)
+			{
+				result[NameLength + i] = suffix[i];
+			}
+
+			return result;
+		}
+	}
+
+	/**
+	 * @brief The variable name of an active demand statistic, as a null-terminated character array.
+	 */
+	template <size_t Slot, ActiveDemandStatistic Statistic>
+	inline constexpr auto ActiveDemandStatisticVariableName = Detail::AppendVariableNameSuffix<
+		std::string_view(Table[Slot].activeDemandVariableName).size(),
+		ActiveDemandStatisticSuffixes[static_cast<size_t>(Statistic)].size()>(
+			Table[Slot].activeDemandVariableName,
+			ActiveDemandStatisticSuffixes[static_cast<size_t>(Statistic)]);
+
+	// The number of months ahead that the demand forecast variables predict,
+	// this must match the forecast variable name suffixes.
+	inline constexpr uint32_t DemandForecastMonths = 6;
+
+	// The demand forecast values that are published for each group, the variable name
+	// is the demand variable name followed by the suffix, e.g. g_ir_demand_forecast_6mo.
+	enum class DemandForecastValue : size_t
+	{
+		Forecast = 0,
+		Low,
+		High,
+		Count
+	};
+
+	inline constexpr std::array<std::string_view, static_cast<size_t>(DemandForecastValue::Count)> DemandForecastSuffixes =
+	{
+		"_forecast_6mo",
+		"_forecast_6mo_low",
+		"_forecast_6mo_high",
+	};
+
+	/**
+	 * @brief The variable name of a demand forecast value, as a null-terminated character array.
+	 */
+	template <size_t Slot, DemandForecastValue Value>
+	inline constexpr auto DemandForecastVariableName = Detail::AppendVariableNameSuffix<
+		std::string_view(Table[Slot].demandVariableName).size(),
+		DemandForecastSuffixes[static_cast<size_t>(Value)].size()>(
+			Table[Slot].demandVariableName,
+			DemandForecastSuffixes[static_cast<size_t>(Value)]);
+}
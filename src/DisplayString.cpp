@@ -0,0 +1,171 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "DisplayString.h"
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string_view>
+
+namespace
+{
+	// The section sign is the simoleon symbol in the game's fonts.
+	constexpr std::string_view SimoleonSymbol = "\xC2\xA7";
+	constexpr std::string_view MonthlySuffix = "/mo";
+
+	struct CompactNumberUnit
+	{
+		double divisor;
+		char suffix;
+	};
+
+	constexpr std::array<CompactNumberUnit, 4> CompactNumberUnits =
+	{
+		CompactNumberUnit{ 1.0, '\0' },
+		CompactNumberUnit{ 1e3, 'K' },
+		CompactNumberUnit{ 1e6, 'M' },
+		CompactNumberUnit{ 1e9, 'B' },
+	};
+
+	int GetCompactNumberPrecision(double scaledValue)
+	{
+		return scaledValue < 10.0 ? 2 : scaledValue < 100.0 ? 1 : 0;
+	}
+
+	double RoundToPrecision(double value, int precision)
+	{
+		constexpr std::array<double, 3> Scales = { 1.0, 10.0, 100.0 };
+
+		const double scale = Scales[static_cast<size_t>(precision)];
+
+		return std::round(value * scale) / scale;
+	}
+
+	char* AppendText(char* first, std::string_view text)
+	{
+		std::memcpy(first, text.data(), text.size());
+		return first + text.size();
+	}
+
+	char* FormatCompactNumber(double value, char* first, char* last)
+	{
+		// The largest value that fits in the buffer with the B suffix.
+		constexpr double MaxMagnitude = 1e15;
+
+		const bool negative = value < 0.0;
+		const double magnitude = std::fmin(std::fabs(value), MaxMagnitude);
+
+		if (std::round(magnitude) < 1000.0)
+		{
+			// Values below one thousand are shown as whole numbers.
+			return std::to_chars(first, last, static_cast<int64_t>(std::round(value))).ptr;
+		}
+
+		size_t unitIndex = 1;
+
+		while (unitIndex + 1 < CompactNumberUnits.size() && magnitude >= CompactNumberUnits[unitIndex + 1].divisor)
+		{
+			unitIndex++;
+		}
+
+		double scaled = magnitude / CompactNumberUnits[unitIndex].divisor;
+		int precision = GetCompactNumberPrecision(scaled);
+		double rounded = RoundToPrecision(scaled, precision);
+
+		// A value such as 999,950 rounds to 1000K, which is shown as 1.00M.
+		if (rounded >= 1000.0 && unitIndex + 1 < CompactNumberUnits.size())
+		{
+			unitIndex++;
+			scaled = magnitude / CompactNumberUnits[unitIndex].divisor;
+			precision = GetCompactNumberPrecision(scaled);
+			rounded = RoundToPrecision(scaled, precision);
+		}
+
+		if (negative)
+		{
+			*first++ = '-';
+		}
+
+		first = std::to_chars(first, last, rounded, std::chars_format::fixed, precision).ptr;
+		*first++ = CompactNumberUnits[unitIndex].suffix;
+
+		return first;
+	}
+
+	char* FormatMonthlyMoney(double value, char* first, char* last)
+	{
+		constexpr double MaxValue = static_cast<double>(std::numeric_limits<int64_t>::max() / 2);
+
+		const int64_t amount = static_cast<int64_t>(std::round(std::fmax(std::fmin(value, MaxValue), -MaxValue)));
+
+		std::array<char, 24> digits{};
+		const char* digitsEnd = std::to_chars(digits.data(), digits.data() + digits.size(), amount < 0 ? -amount : amount).ptr;
+		const size_t digitCount = static_cast<size_t>(digitsEnd - digits.data());
+
+		if (amount < 0)
+		{
+			*first++ = '-';
+		}
+
+		first = AppendText(first, SimoleonSymbol);
+
+		for (size_t i = 0; i < digitCount; i++)
+		{
+			if (i > 0 && ((digitCount - i) % 3) == 0)
+			{
+				*first++ = ',';
+			}
+
+			*first++ = digits[i];
+		}
+
+		return AppendText(first, MonthlySuffix);
+	}
+}
+
+size_t FormatDisplayString(DisplayStringFormat format, double value, char* buffer, size_t bufferSize)
+{
+	if (bufferSize < kDisplayStringBufferSize)
+	{
+		if (bufferSize > 0)
+		{
+			buffer[0] = '\0';
+		}
+
+		return 0;
+	}
+
+	if (!std::isfinite(value))
+	{
+		value = 0.0;
+	}
+
+	char* const last = buffer + bufferSize - 1;
+	char* end = buffer;
+
+	switch (format)
+	{
+	case DisplayStringFormat::MonthlyMoney:
+		end = FormatMonthlyMoney(value, buffer, last);
+		break;
+	case DisplayStringFormat::CompactNumber:
+	default:
+		end = FormatCompactNumber(value, buffer, last);
+		break;
+	}
+
+	*end = '\0';
+
+	return static_cast<size_t>(end - buffer);
+}
@@ -0,0 +1,37 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+enum class DisplayStringFormat : int32_t
+{
+	// A number with three significant digits and a K, M or B suffix, e.g. 1.24M.
+	CompactNumber = 0,
+	// A whole number of simoleons per month with thousands separators, e.g. §12,340/mo.
+	MonthlyMoney = 1,
+};
+
+// The buffer size that is large enough for any formatted value, including the
+// terminating null character.
+inline constexpr size_t kDisplayStringBufferSize = 48;
+
+/**
+ * @brief Formats a value for display in the game's UI text.
+ * @param format The display format.
+ * @param value The value to format.
+ * @param buffer The buffer that receives the null-terminated UTF-8 string.
+ * @param bufferSize The size of the buffer, this must be at least kDisplayStringBufferSize.
+ * @return The length of the string, excluding the terminating null character.
+ */
+size_t FormatDisplayString(DisplayStringFormat format, double value, char* buffer, size_t bufferSize);
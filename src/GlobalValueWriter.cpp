@@ -0,0 +1,155 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "GlobalValueWriter.h"
+#include "Instrumentation.h"
+#include "cISC4AdvisorSystem.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+GlobalValueWriter::GlobalValueWriter(GlobalValueDeadbandMode mode, double epsilon)
+	: pAdvisorSystem(nullptr),
+	  mode(mode),
+	  epsilon(epsilon),
+	  generation(1),
+	  emittedWrites(0),
+	  suppressedWrites(0)
+{
+}
+
+void GlobalValueWriter::SetAdvisorSystem(cISC4AdvisorSystem* pAdvisorSystem)
+{
+	this->pAdvisorSystem = pAdvisorSystem;
+	InvalidateAll();
+}
+
+void GlobalValueWriter::InvalidateAll()
+{
+	generation++;
+
+	if (generation == 0)
+	{
+		generation = 1;
+	}
+}
+
+bool GlobalValueWriter::SetGlobalValue(GlobalValueShadow& shadow, const char* name, double value)
+{
+	if (!pAdvisorSystem)
+	{
+		return false;
+	}
+
+	if (shadow.generation == generation && IsWithinDeadband(shadow.value, value))
+	{
+		suppressedWrites++;
+		return true;
+	}
+
+	// The SetGlobalValue method will add the value to the LUA scripting system.
+	// It can be accessed from a script or UI placeholder text using game.<value name>.
+	const bool result = INSTRUMENT_CALL(
+		InstrumentedCallSite::SetGlobalValue,
+		pAdvisorSystem->SetGlobalValue(name, value));
+
+	if (result)
+	{
+		shadow.value = value;
+		shadow.generation = generation;
+	}
+
+	emittedWrites++;
+	return result;
+}
+
+bool GlobalValueWriter::SetGlobalString(GlobalStringShadow& shadow, const char* name, double value, DisplayStringFormat format)
+{
+	if (!pAdvisorSystem)
+	{
+		return false;
+	}
+
+	const bool shadowValid = shadow.value.generation == generation;
+
+	if (shadowValid && IsWithinDeadband(shadow.value.value, value))
+	{
+		suppressedWrites++;
+		return true;
+	}
+
+	char buffer[kDisplayStringBufferSize];
+	const uint32_t length = static_cast<uint32_t>(FormatDisplayString(format, value, buffer, sizeof(buffer)));
+
+	// Many value changes do not change the displayed text, e.g. 1,240,100 and 1,240,200 are both 1.24M.
+	if (shadowValid && shadow.text.IsEqual(buffer, length, true))
+	{
+		shadow.value.value = value;
+		suppressedWrites++;
+		return true;
+	}
+
+	shadow.text.FromChar(buffer, length);
+
+	const bool result = INSTRUMENT_CALL(
+		InstrumentedCallSite::SetGlobalValue,
+		pAdvisorSystem->SetGlobalValue(name, &shadow.text));
+
+	if (result)
+	{
+		shadow.value.value = value;
+		shadow.value.generation = generation;
+	}
+	else
+	{
+		// The text no longer matches the game's value, so it must not suppress the next write.
+		shadow.value.generation = 0;
+	}
+
+	emittedWrites++;
+	return result;
+}
+
+uint64_t GlobalValueWriter::GetEmittedWriteCount() const
+{
+	return emittedWrites;
+}
+
+uint64_t GlobalValueWriter::GetSuppressedWriteCount() const
+{
+	return suppressedWrites;
+}
+
+void GlobalValueWriter::ResetCounters()
+{
+	emittedWrites = 0;
+	suppressedWrites = 0;
+}
+
+bool GlobalValueWriter::IsWithinDeadband(double previousValue, double value) const
+{
+	if (std::bit_cast<uint64_t>(previousValue) == std::bit_cast<uint64_t>(value))
+	{
+		return true;
+	}
+
+	switch (mode)
+	{
+	case GlobalValueDeadbandMode::Absolute:
+		return std::fabs(value - previousValue) <= epsilon;
+	case GlobalValueDeadbandMode::Relative:
+		return std::fabs(value - previousValue) <= epsilon * std::max(std::fabs(previousValue), std::fabs(value));
+	case GlobalValueDeadbandMode::Exact:
+	default:
+		return false;
+	}
+}
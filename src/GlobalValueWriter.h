@@ -0,0 +1,106 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "DisplayString.h"
+#include "cRZBaseString.h"
+#include <cstdint>
+
+class cISC4AdvisorSystem;
+
+enum class GlobalValueDeadbandMode : int32_t
+{
+	// Only values that are not bit-identical to the previous value are written.
+	Exact = 0,
+	// Values that are within epsilon of the previous value are not written.
+	Absolute = 1,
+	// Values that are within epsilon times the larger magnitude of the
+	// previous and new values are not written.
+	Relative = 2
+};
+
+/**
+ * @brief The last value that was written to a Lua global variable.
+ */
+struct GlobalValueShadow
+{
+	double value;
+	uint32_t generation;
+};
+
+/**
+ * @brief The last value and display string that were written to a Lua global variable.
+ *
+ * The string is reused for every write, so its buffer is only allocated once.
+ */
+struct GlobalStringShadow
+{
+	GlobalValueShadow value;
+	cRZBaseString text;
+};
+
+/**
+ * @brief Writes Lua global variables through cISC4AdvisorSystem::SetGlobalValue,
+ * skipping the writes that would not change the value.
+ */
+class GlobalValueWriter
+{
+public:
+	GlobalValueWriter(GlobalValueDeadbandMode mode, double epsilon);
+
+	void SetAdvisorSystem(cISC4AdvisorSystem* pAdvisorSystem);
+
+	/**
+	 * @brief Marks all of the shadow values as stale.
+	 *
+	 * This must be called when SC4 creates a new Lua state, e.g. when a city is loaded.
+	 */
+	void InvalidateAll();
+
+	/**
+	 * @brief Sets the Lua global variable if the value changed since it was last set.
+	 * @param shadow The shadow value for the variable.
+	 * @param name The variable name.
+	 * @param value The new value.
+	 * @return True if the value was written or the write was not needed; otherwise, false.
+	 */
+	bool SetGlobalValue(GlobalValueShadow& shadow, const char* name, double value);
+
+	/**
+	 * @brief Sets the Lua global variable to the display string of the value, the string is
+	 * only formatted when the value changed and only written when the string changed.
+	 * @param shadow The shadow value and string for the variable.
+	 * @param name The variable name.
+	 * @param value The new value.
+	 * @param format The display format.
+	 * @return True if the string was written or the write was not needed; otherwise, false.
+	 */
+	bool SetGlobalString(GlobalStringShadow& shadow, const char* name, double value, DisplayStringFormat format);
+
+	uint64_t GetEmittedWriteCount() const;
+
+	uint64_t GetSuppressedWriteCount() const;
+
+	void ResetCounters();
+
+private:
+	bool IsWithinDeadband(double previousValue, double value) const;
+
+	cISC4AdvisorSystem* pAdvisorSystem;
+	GlobalValueDeadbandMode mode;
+	double epsilon;
+	// A shadow value is only valid if its generation matches the writer's generation.
+	// Generation 0 is never used, so zero-initialized shadow values are always stale.
+	uint32_t generation;
+	uint64_t emittedWrites;
+	uint64_t suppressedWrites;
+};
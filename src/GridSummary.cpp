@@ -0,0 +1,288 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "GridSummary.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// The values are reduced with four independent accumulators, this removes the
+	// dependency between the loop iterations so that the compiler can vectorize it.
+	constexpr size_t kLaneCount = 4;
+
+	// The percentiles are interpolated from a histogram with this many bins, this is
+	// more precise than the published histogram and avoids sorting the values.
+	constexpr size_t kPercentileBinCount = 256;
+
+	static_assert(kPercentileBinCount % kGridSummaryHistogramBinCount == 0);
+
+	constexpr std::array<double, GridPercentileCount> PercentileRanks = { 0.10, 0.50, 0.90 };
+	constexpr std::array<std::string_view, GridPercentileCount> PercentileSuffixes = { "_p10", "_p50", "_p90" };
+
+	struct ValueRange
+	{
+		double sum;
+		float min;
+		float max;
+	};
+
+	ValueRange ReduceValues(const float* values, size_t count)
+	{
+		std::array<double, kLaneCount> sums{};
+		std::array<float, kLaneCount> mins;
+		std::array<float, kLaneCount> maxes;
+
+		mins.fill(values[0]);
+		maxes.fill(values[0]);
+
+		const size_t vectorCount = count - (count % kLaneCount);
+
+		for (size_t i = 0; i < vectorCount; i += kLaneCount)
+		{
+			for (size_t lane = 0; lane < kLaneCount; lane++)
+			{
+				const float value = values[i + lane];
+
+				sums[lane] += value;
+				mins[lane] = value < mins[lane] ? value : mins[lane];
+				maxes[lane] = value > maxes[lane] ? value : maxes[lane];
+			}
+		}
+
+		for (size_t i = vectorCount; i < count; i++)
+		{
+			const float value = values[i];
+
+			sums[0] += value;
+			mins[0] = value < mins[0] ? value : mins[0];
+			maxes[0] = value > maxes[0] ? value : maxes[0];
+		}
+
+		ValueRange range{};
+		range.sum = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+		range.min = *std::min_element(mins.begin(), mins.end());
+		range.max = *std::max_element(maxes.begin(), maxes.end());
+
+		return range;
+	}
+
+	float SumSpan(const float* values, size_t count)
+	{
+		std::array<float, kLaneCount> sums{};
+
+		const size_t vectorCount = count - (count % kLaneCount);
+
+		for (size_t i = 0; i < vectorCount; i += kLaneCount)
+		{
+			for (size_t lane = 0; lane < kLaneCount; lane++)
+			{
+				sums[lane] += values[i + lane];
+			}
+		}
+
+		for (size_t i = vectorCount; i < count; i++)
+		{
+			sums[0] += values[i];
+		}
+
+		return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+	}
+
+	// Gets the first tract of each tile along an axis, the last entry is the tract count.
+	std::array<uint32_t, kGridSummaryTileCount + 1> GetTileBounds(uint32_t tractCount)
+	{
+		std::array<uint32_t, kGridSummaryTileCount + 1> bounds{};
+
+		for (size_t i = 0; i <= kGridSummaryTileCount; i++)
+		{
+			bounds[i] = static_cast<uint32_t>((static_cast<uint64_t>(tractCount) * i) / kGridSummaryTileCount);
+		}
+
+		return bounds;
+	}
+}
+
+std::array<std::string, kGridSummaryValueCount> CreateGridSummaryVariableNames(std::string_view prefix)
+{
+	std::array<std::string, kGridSummaryValueCount> names;
+
+	size_t index = 0;
+
+	const auto addName = [&](std::string_view suffix)
+	{
+		std::string& name = names[index++];
+		name.reserve(prefix.size() + suffix.size());
+		name.append(prefix);
+		name.append(suffix);
+	};
+
+	addName("_avg");
+	addName("_min");
+	addName("_max");
+
+	for (const std::string_view& suffix : PercentileSuffixes)
+	{
+		addName(suffix);
+	}
+
+	for (size_t z = 0; z < kGridSummaryTileCount; z++)
+	{
+		for (size_t x = 0; x < kGridSummaryTileCount; x++)
+		{
+			const char tileSuffix[] = { '_', 't', 'i', 'l', 'e', '_', static_cast<char>('0' + x), static_cast<char>('0' + z) };
+
+			addName(std::string_view(tileSuffix, sizeof(tileSuffix)));
+		}
+	}
+
+	for (size_t i = 0; i < kGridSummaryHistogramBinCount; i++)
+	{
+		const char binSuffix[] = { '_', 'h', 'i', 's', 't', '_', static_cast<char>('0' + i) };
+
+		addName(std::string_view(binSuffix, sizeof(binSuffix)));
+	}
+
+	return names;
+}
+
+std::array<double, kGridSummaryValueCount> GetGridSummaryValues(const GridSummary& summary)
+{
+	std::array<double, kGridSummaryValueCount> values{};
+
+	size_t index = 0;
+
+	values[index++] = summary.mean;
+	values[index++] = summary.min;
+	values[index++] = summary.max;
+
+	for (float value : summary.percentiles)
+	{
+		values[index++] = value;
+	}
+
+	for (float value : summary.tiles)
+	{
+		values[index++] = value;
+	}
+
+	for (float value : summary.histogram)
+	{
+		values[index++] = value;
+	}
+
+	return values;
+}
+
+GridSummarizer::GridSummarizer()
+	: values()
+{
+}
+
+void GridSummarizer::SummarizeValues(uint32_t countX, uint32_t countZ, GridSummary& summary)
+{
+	summary = {};
+	summary.tractCountX = countX;
+	summary.tractCountZ = countZ;
+
+	const float* const data = values.data();
+	const size_t count = values.size();
+
+	const ValueRange range = ReduceValues(data, count);
+
+	summary.mean = static_cast<float>(range.sum / static_cast<double>(count));
+	summary.min = range.min;
+	summary.max = range.max;
+
+	// Each row is split into the spans of its tiles, the spans are contiguous so
+	// their sums can be vectorized.
+	const std::array<uint32_t, kGridSummaryTileCount + 1> tileBoundsX = GetTileBounds(countX);
+	const std::array<uint32_t, kGridSummaryTileCount + 1> tileBoundsZ = GetTileBounds(countZ);
+
+	std::array<double, kGridSummaryTileCount * kGridSummaryTileCount> tileSums{};
+
+	for (size_t tileZ = 0; tileZ < kGridSummaryTileCount; tileZ++)
+	{
+		for (uint32_t z = tileBoundsZ[tileZ]; z < tileBoundsZ[tileZ + 1]; z++)
+		{
+			const float* row = data + (static_cast<size_t>(z) * countX);
+
+			for (size_t tileX = 0; tileX < kGridSummaryTileCount; tileX++)
+			{
+				const uint32_t first = tileBoundsX[tileX];
+				const uint32_t last = tileBoundsX[tileX + 1];
+
+				tileSums[(tileZ * kGridSummaryTileCount) + tileX] += SumSpan(row + first, last - first);
+			}
+		}
+	}
+
+	for (size_t tileZ = 0; tileZ < kGridSummaryTileCount; tileZ++)
+	{
+		for (size_t tileX = 0; tileX < kGridSummaryTileCount; tileX++)
+		{
+			const size_t tileIndex = (tileZ * kGridSummaryTileCount) + tileX;
+			const uint64_t tileArea = static_cast<uint64_t>(tileBoundsX[tileX + 1] - tileBoundsX[tileX])
+				* static_cast<uint64_t>(tileBoundsZ[tileZ + 1] - tileBoundsZ[tileZ]);
+
+			// A grid that is smaller than the tile count has empty tiles.
+			summary.tiles[tileIndex] = tileArea > 0 ? static_cast<float>(tileSums[tileIndex] / static_cast<double>(tileArea)) : 0.0f;
+		}
+	}
+
+	std::array<uint32_t, kPercentileBinCount> bins{};
+
+	const double valueRange = static_cast<double>(range.max) - static_cast<double>(range.min);
+	const float binScale = valueRange > 0.0 ? static_cast<float>(kPercentileBinCount / valueRange) : 0.0f;
+	const float maxBin = static_cast<float>(kPercentileBinCount - 1);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const float bin = std::min((data[i] - range.min) * binScale, maxBin);
+
+		bins[static_cast<size_t>(bin)]++;
+	}
+
+	constexpr size_t BinsPerHistogramBin = kPercentileBinCount / kGridSummaryHistogramBinCount;
+
+	for (size_t i = 0; i < kPercentileBinCount; i++)
+	{
+		summary.histogram[i / BinsPerHistogramBin] += static_cast<float>(bins[i]);
+	}
+
+	for (float& value : summary.histogram)
+	{
+		value /= static_cast<float>(count);
+	}
+
+	const double binWidth = valueRange / kPercentileBinCount;
+
+	for (size_t i = 0; i < GridPercentileCount; i++)
+	{
+		const double targetRank = PercentileRanks[i] * static_cast<double>(count);
+
+		uint64_t cumulativeCount = 0;
+		size_t bin = 0;
+
+		while (bin < kPercentileBinCount - 1 && static_cast<double>(cumulativeCount + bins[bin]) < targetRank)
+		{
+			cumulativeCount += bins[bin];
+			bin++;
+		}
+
+		// The values are assumed to be evenly distributed within a bin.
+		const double fraction = bins[bin] > 0 ? (targetRank - static_cast<double>(cumulativeCount)) / bins[bin] : 0.0;
+		const double value = range.min + ((static_cast<double>(bin) + std::clamp(fraction, 0.0, 1.0)) * binWidth);
+
+		summary.percentiles[i] = static_cast<float>(std::min(value, static_cast<double>(range.max)));
+	}
+}
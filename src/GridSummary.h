@@ -0,0 +1,149 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "cISC4SimGrid.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The number of coarse tiles along each axis of the city.
+inline constexpr size_t kGridSummaryTileCount = 4;
+inline constexpr size_t kGridSummaryHistogramBinCount = 8;
+
+enum class GridPercentile : size_t
+{
+	P10 = 0,
+	P50,
+	P90,
+	Count
+};
+
+inline constexpr size_t GridPercentileCount = static_cast<size_t>(GridPercentile::Count);
+
+struct GridSummary
+{
+	uint32_t tractCountX;
+	uint32_t tractCountZ;
+	float mean;
+	float min;
+	float max;
+	std::array<float, GridPercentileCount> percentiles;
+	// The mean of each coarse tile, the X axis varies fastest.
+	std::array<float, kGridSummaryTileCount * kGridSummaryTileCount> tiles;
+	// The fraction of the tracts in each of the equal-width bins between min and max.
+	std::array<float, kGridSummaryHistogramBinCount> histogram;
+};
+
+// The number of values that a summary publishes:
+// avg, min, max, the percentiles, the tiles and the histogram bins.
+inline constexpr size_t kGridSummaryValueCount = 3
+	+ GridPercentileCount
+	+ (kGridSummaryTileCount * kGridSummaryTileCount)
+	+ kGridSummaryHistogramBinCount;
+
+/**
+ * @brief Creates the variable names of a summary's values, e.g. g_police_coverage_p50.
+ * @param prefix The variable name prefix, e.g. g_police_coverage.
+ */
+std::array<std::string, kGridSummaryValueCount> CreateGridSummaryVariableNames(std::string_view prefix);
+
+/**
+ * @brief Gets the summary's values in the order of CreateGridSummaryVariableNames.
+ */
+std::array<double, kGridSummaryValueCount> GetGridSummaryValues(const GridSummary& summary);
+
+/**
+ * @brief Downsamples a simulation grid into coarse tiles and computes its statistics.
+ *
+ * The grid values are copied into a reused buffer, so a summary does not allocate
+ * after the first grid of the same size.
+ */
+class GridSummarizer
+{
+public:
+	GridSummarizer();
+
+	template <typename T>
+	bool Summarize(cISC4SimGrid<T>* pGrid, GridSummary& summary)
+	{
+		if (!pGrid)
+		{
+			return false;
+		}
+
+		const int32_t countX = pGrid->GetTractCountX();
+		const int32_t countZ = pGrid->GetTractCountZ();
+
+		if (countX <= 0 || countZ <= 0)
+		{
+			return false;
+		}
+
+		// The layout of the GetGridData buffer is not documented, so the values are
+		// read through GetTractValue.
+		return Summarize(
+			static_cast<uint32_t>(countX),
+			static_cast<uint32_t>(countZ),
+			[pGrid](uint32_t x, uint32_t z, float& value)
+			{
+				value = static_cast<float>(pGrid->GetTractValue(static_cast<int32_t>(x), static_cast<int32_t>(z)));
+				return true;
+			},
+			summary);
+	}
+
+	/**
+	 * @brief Summarizes a grid that is read one cell at a time.
+	 * @param countX The number of cells along the X axis.
+	 * @param countZ The number of cells along the Z axis.
+	 * @param readValue A function that is called with the cell coordinates and a reference
+	 * that receives the cell value, it returns false if the value could not be read.
+	 * @param summary The summary of the grid.
+	 * @return True if the grid was summarized; otherwise, false if it is empty or a value
+	 * could not be read.
+	 */
+	template <typename TReadValue>
+	bool Summarize(uint32_t countX, uint32_t countZ, TReadValue&& readValue, GridSummary& summary)
+	{
+		if (countX == 0 || countZ == 0)
+		{
+			return false;
+		}
+
+		values.resize(static_cast<size_t>(countX) * static_cast<size_t>(countZ));
+
+		for (uint32_t z = 0; z < countZ; z++)
+		{
+			float* row = values.data() + (static_cast<size_t>(z) * static_cast<size_t>(countX));
+
+			for (uint32_t x = 0; x < countX; x++)
+			{
+				if (!readValue(x, z, row[x]))
+				{
+					return false;
+				}
+			}
+		}
+
+		SummarizeValues(countX, countZ, summary);
+		return true;
+	}
+
+private:
+	void SummarizeValues(uint32_t countX, uint32_t countZ, GridSummary& summary);
+
+	std::vector<float> values;
+};
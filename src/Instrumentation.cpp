@@ -0,0 +1,258 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "Instrumentation.h"
+
+#ifdef SC4_MORE_DEMAND_INFO_INSTRUMENTATION
+
+#include "GlobalValueWriter.h"
+#include "Logger.h"
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdio>
+
+namespace
+{
+	// Bucket i holds the durations that are in the range of [2^(i - 1), 2^i) nanoseconds,
+	// bucket 0 holds the zero durations and the last bucket holds everything longer than ~1 second.
+	constexpr size_t kLatencyBucketCount = 32;
+
+	constexpr size_t kCallSiteCount = static_cast<size_t>(InstrumentedCallSite::Count);
+
+	constexpr std::array<const char*, kCallSiteCount> CallSiteNames =
+	{
+		"DoMessage",
+		"GetDemand",
+		"SetGlobalValue",
+		"GetTaxIncome",
+		"RegionScanCapture",
+		"RegionScanApply",
+		"GridSummary",
+	};
+
+	constexpr std::array<std::array<const char*, 3>, kCallSiteCount> CallSiteVariableNames =
+	{
+		std::array<const char*, 3>{ "g_moredemand_stats_domessage_count", "g_moredemand_stats_domessage_mean_us", "g_moredemand_stats_domessage_max_us" },
+		std::array<const char*, 3>{ "g_moredemand_stats_getdemand_count", "g_moredemand_stats_getdemand_mean_us", "g_moredemand_stats_getdemand_max_us" },
+		std::array<const char*, 3>{ "g_moredemand_stats_setglobalvalue_count", "g_moredemand_stats_setglobalvalue_mean_us", "g_moredemand_stats_setglobalvalue_max_us" },
+		std::array<const char*, 3>{ "g_moredemand_stats_gettaxincome_count", "g_moredemand_stats_gettaxincome_mean_us", "g_moredemand_stats_gettaxincome_max_us" },
+		std::array<const char*, 3>{ "g_moredemand_stats_regionscancapture_count", "g_moredemand_stats_regionscancapture_mean_us", "g_moredemand_stats_regionscancapture_max_us" },
+		std::array<const char*, 3>{ "g_moredemand_stats_regionscanapply_count", "g_moredemand_stats_regionscanapply_mean_us", "g_moredemand_stats_regionscanapply_max_us" },
+		std::array<const char*, 3>{ "g_moredemand_stats_gridsummary_count", "g_moredemand_stats_gridsummary_mean_us", "g_moredemand_stats_gridsummary_max_us" },
+	};
+
+	// The region scan is timed on a worker thread, so the values are updated atomically.
+	struct LatencyHistogram
+	{
+		std::array<std::atomic<uint64_t>, kLatencyBucketCount> buckets;
+		std::atomic<uint64_t> count;
+		std::atomic<uint64_t> totalNanoseconds;
+		std::atomic<uint64_t> maxNanoseconds;
+	};
+
+	struct MessageCounter
+	{
+		std::atomic<uint32_t> messageType;
+		std::atomic<uint64_t> count;
+	};
+
+	// The plugin only subscribes to a few message types, any types that do not
+	// fit in the table are counted as other messages.
+	constexpr size_t kMessageCounterCount = 16;
+
+	std::array<LatencyHistogram, kCallSiteCount> latencyHistograms;
+	std::array<MessageCounter, kMessageCounterCount> messageCounters;
+	std::atomic<uint64_t> otherMessageCount;
+
+	std::array<std::array<GlobalValueShadow, 3>, kCallSiteCount> callSiteShadows;
+	std::array<GlobalValueShadow, kMessageCounterCount> messageCountShadows;
+
+	size_t GetLatencyBucket(uint64_t nanoseconds)
+	{
+		const size_t bucket = static_cast<size_t>(std::bit_width(nanoseconds));
+
+		return bucket < kLatencyBucketCount ? bucket : kLatencyBucketCount - 1;
+	}
+
+	uint64_t GetBucketUpperBound(size_t bucket)
+	{
+		return bucket == 0 ? 0 : (uint64_t(1) << bucket) - 1;
+	}
+
+	// Gets an upper bound of the percentile from the histogram buckets.
+	uint64_t GetPercentile(const LatencyHistogram& histogram, uint64_t count, double percentile)
+	{
+		const uint64_t target = static_cast<uint64_t>(static_cast<double>(count) * percentile);
+		uint64_t cumulative = 0;
+
+		for (size_t i = 0; i < kLatencyBucketCount; i++)
+		{
+			cumulative += histogram.buckets[i].load(std::memory_order_relaxed);
+
+			if (cumulative > target)
+			{
+				return GetBucketUpperBound(i);
+			}
+		}
+
+		return GetBucketUpperBound(kLatencyBucketCount - 1);
+	}
+}
+
+void Instrumentation::RecordMessage(uint32_t messageType)
+{
+	for (MessageCounter& counter : messageCounters)
+	{
+		uint32_t existingType = counter.messageType.load(std::memory_order_relaxed);
+
+		// Message type 0 marks an unused table entry.
+		if (existingType == 0)
+		{
+			if (counter.messageType.compare_exchange_strong(existingType, messageType, std::memory_order_relaxed)
+				|| existingType == messageType)
+			{
+				counter.count.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+		}
+		else if (existingType == messageType)
+		{
+			counter.count.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+	}
+
+	otherMessageCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Instrumentation::RecordLatency(InstrumentedCallSite site, uint64_t nanoseconds)
+{
+	LatencyHistogram& histogram = latencyHistograms[static_cast<size_t>(site)];
+
+	histogram.buckets[GetLatencyBucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+	histogram.count.fetch_add(1, std::memory_order_relaxed);
+	histogram.totalNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+	uint64_t currentMax = histogram.maxNanoseconds.load(std::memory_order_relaxed);
+
+	while (nanoseconds > currentMax
+		&& !histogram.maxNanoseconds.compare_exchange_weak(currentMax, nanoseconds, std::memory_order_relaxed))
+	{
+	}
+}
+
+void Instrumentation::WriteToLog()
+{
+	Logger& logger = Logger::GetInstance();
+
+	for (const MessageCounter& counter : messageCounters)
+	{
+		const uint32_t messageType = counter.messageType.load(std::memory_order_relaxed);
+
+		if (messageType != 0)
+		{
+			logger.WriteLine(
+				LogLevel::Info,
+				"Message 0x{:08X}: {} received.",
+				messageType,
+				counter.count.load(std::memory_order_relaxed));
+		}
+	}
+
+	const uint64_t otherMessages = otherMessageCount.load(std::memory_order_relaxed);
+
+	if (otherMessages > 0)
+	{
+		logger.WriteLine(LogLevel::Info, "Other messages: {} received.", otherMessages);
+	}
+
+	for (size_t i = 0; i < kCallSiteCount; i++)
+	{
+		const LatencyHistogram& histogram = latencyHistograms[i];
+		const uint64_t count = histogram.count.load(std::memory_order_relaxed);
+
+		if (count == 0)
+		{
+			continue;
+		}
+
+		const uint64_t totalNanoseconds = histogram.totalNanoseconds.load(std::memory_order_relaxed);
+
+		logger.WriteLine(
+			LogLevel::Info,
+			"{}: {} calls, mean {} ns, p50 <= {} ns, p99 <= {} ns, max {} ns.",
+			CallSiteNames[i],
+			count,
+			totalNanoseconds / count,
+			GetPercentile(histogram, count, 0.50),
+			GetPercentile(histogram, count, 0.99),
+			histogram.maxNanoseconds.load(std::memory_order_relaxed));
+	}
+}
+
+void Instrumentation::PublishGlobalValues(GlobalValueWriter& writer)
+{
+	for (size_t i = 0; i < kCallSiteCount; i++)
+	{
+		const LatencyHistogram& histogram = latencyHistograms[i];
+		const uint64_t count = histogram.count.load(std::memory_order_relaxed);
+		const uint64_t totalNanoseconds = histogram.totalNanoseconds.load(std::memory_order_relaxed);
+		const uint64_t maxNanoseconds = histogram.maxNanoseconds.load(std::memory_order_relaxed);
+
+		const double meanMicroseconds = count > 0 ? static_cast<double>(totalNanoseconds) / static_cast<double>(count) / 1000.0 : 0.0;
+
+		writer.SetGlobalValue(callSiteShadows[i][0], CallSiteVariableNames[i][0], static_cast<double>(count));
+		writer.SetGlobalValue(callSiteShadows[i][1], CallSiteVariableNames[i][1], meanMicroseconds);
+		writer.SetGlobalValue(callSiteShadows[i][2], CallSiteVariableNames[i][2], static_cast<double>(maxNanoseconds) / 1000.0);
+	}
+
+	for (size_t i = 0; i < kMessageCounterCount; i++)
+	{
+		const MessageCounter& counter = messageCounters[i];
+		const uint32_t messageType = counter.messageType.load(std::memory_order_relaxed);
+
+		if (messageType != 0)
+		{
+			// The names are only built when the statistics are published.
+			char name[64]{};
+			std::snprintf(name, sizeof(name), "g_moredemand_stats_msg_%08x_count", messageType);
+
+			writer.SetGlobalValue(messageCountShadows[i], name, static_cast<double>(counter.count.load(std::memory_order_relaxed)));
+		}
+	}
+}
+
+void Instrumentation::Reset()
+{
+	for (LatencyHistogram& histogram : latencyHistograms)
+	{
+		for (std::atomic<uint64_t>& bucket : histogram.buckets)
+		{
+			bucket.store(0, std::memory_order_relaxed);
+		}
+
+		histogram.count.store(0, std::memory_order_relaxed);
+		histogram.totalNanoseconds.store(0, std::memory_order_relaxed);
+		histogram.maxNanoseconds.store(0, std::memory_order_relaxed);
+	}
+
+	for (MessageCounter& counter : messageCounters)
+	{
+		counter.messageType.store(0, std::memory_order_relaxed);
+		counter.count.store(0, std::memory_order_relaxed);
+	}
+
+	otherMessageCount.store(0, std::memory_order_relaxed);
+}
+
+#endif // SC4_MORE_DEMAND_INFO_INSTRUMENTATION
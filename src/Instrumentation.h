@@ -0,0 +1,95 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <cstdint>
+
+// The instrumentation is only compiled when SC4_MORE_DEMAND_INFO_INSTRUMENTATION is defined,
+// otherwise the INSTRUMENT_* macros expand to nothing.
+
+enum class InstrumentedCallSite : uint32_t
+{
+	DoMessage = 0,
+	GetDemand,
+	SetGlobalValue,
+	GetTaxIncome,
+	RegionScanCapture,
+	RegionScanApply,
+	GridSummary,
+	Count
+};
+
+#ifdef SC4_MORE_DEMAND_INFO_INSTRUMENTATION
+
+#include <chrono>
+
+class GlobalValueWriter;
+
+namespace Instrumentation
+{
+	void RecordMessage(uint32_t messageType);
+
+	void RecordLatency(InstrumentedCallSite site, uint64_t nanoseconds);
+
+	void WriteToLog();
+
+	/**
+	 * @brief Publishes the statistics as g_moredemand_stats_* Lua variables.
+	 */
+	void PublishGlobalValues(GlobalValueWriter& writer);
+
+	void Reset();
+
+	class ScopedLatencyTimer
+	{
+	public:
+		explicit ScopedLatencyTimer(InstrumentedCallSite site)
+			: site(site), start(std::chrono::steady_clock::now())
+		{
+		}
+
+		~ScopedLatencyTimer()
+		{
+			const auto elapsed = std::chrono::steady_clock::now() - start;
+
+			RecordLatency(site, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+		}
+
+		ScopedLatencyTimer(const ScopedLatencyTimer&) = delete;
+		ScopedLatencyTimer& operator=(const ScopedLatencyTimer&) = delete;
+
+	private:
+		InstrumentedCallSite site;
+		std::chrono::steady_clock::time_point start;
+	};
+}
+
+#define INSTRUMENT_CONCAT_IMPL(a, b) a##b
+#define INSTRUMENT_CONCAT(a, b) INSTRUMENT_CONCAT_IMPL(a, b)
+
+#define INSTRUMENT_MESSAGE(messageType) Instrumentation::RecordMessage(messageType)
+#define INSTRUMENT_SCOPE(site) Instrumentation::ScopedLatencyTimer INSTRUMENT_CONCAT(instrumentationTimer_, __LINE__)(site)
+#define INSTRUMENT_CALL(site, expression) [&]() -> decltype(auto) { Instrumentation::ScopedLatencyTimer timer(site); return expression; }()
+#define INSTRUMENT_WRITE_TO_LOG() Instrumentation::WriteToLog()
+#define INSTRUMENT_PUBLISH_GLOBAL_VALUES(writer) Instrumentation::PublishGlobalValues(writer)
+#define INSTRUMENT_RESET() Instrumentation::Reset()
+
+#else
+
+#define INSTRUMENT_MESSAGE(messageType) ((void)0)
+#define INSTRUMENT_SCOPE(site) ((void)0)
+#define INSTRUMENT_CALL(site, expression) (expression)
+#define INSTRUMENT_WRITE_TO_LOG() ((void)0)
+#define INSTRUMENT_PUBLISH_GLOBAL_VALUES(writer) ((void)0)
+#define INSTRUMENT_RESET() ((void)0)
+
+#endif // SC4_MORE_DEMAND_INFO_INSTRUMENTATION
@@ -11,31 +11,51 @@
 //////////////////////////////////////////////////////////////////////////
 
 #include "Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <Windows.h>
 
 namespace
 {
-	std::string GetTimeStamp()
+	// Formats the time stamp into the buffer and returns its length.
+	size_t FormatTimeStamp(uint64_t fileTime, char* buffer, size_t bufferSize)
 	{
-		char buffer[1024]{};
+		FILETIME utcTime{};
+		utcTime.dwLowDateTime = static_cast<DWORD>(fileTime);
+		utcTime.dwHighDateTime = static_cast<DWORD>(fileTime >> 32);
 
-		GetTimeFormatA(
+		FILETIME localTime{};
+		SYSTEMTIME systemTime{};
+
+		const SYSTEMTIME* time = nullptr;
+
+		if (FileTimeToLocalFileTime(&utcTime, &localTime) && FileTimeToSystemTime(&localTime, &systemTime))
+		{
+			time = &systemTime;
+		}
+
+		const int result = GetTimeFormatA(
 			LOCALE_USER_DEFAULT,
 			0,
-			nullptr,
+			time,
 			nullptr,
 			buffer,
-			_countof(buffer));
+			static_cast<int>(bufferSize - 1));
 
-		std::string time(buffer);
+		// The length returned by GetTimeFormatA includes the terminating null character.
+		size_t length = result > 0 ? static_cast<size_t>(result) - 1 : 0;
 
 		// Add a space to the end of the time string if it doe not have one.
-		if (time.size() > 0 && time[time.size() - 1] != ' ')
+		if (length > 0 && buffer[length - 1] != ' ')
 		{
-			time.append(1, ' ');
+			buffer[length] = ' ';
+			length++;
 		}
 
-		return time;
+		buffer[length] = '\0';
+
+		return length;
 	}
 
 #ifdef _DEBUG
@@ -46,6 +66,32 @@ namespace
 		OutputDebugStringA("\n");
 	}
 #endif // _DEBUG
+
+	// The background thread flushes the log file at this interval while it is writing.
+	constexpr std::chrono::milliseconds kFlushInterval(250);
+	// The maximum time that the background thread waits for new log lines.
+	constexpr std::chrono::milliseconds kWriterWaitTimeout(100);
+}
+
+Logger::TimeStampCache::TimeStampCache()
+	: cachedSecond(UINT64_MAX),
+	  length(0),
+	  text()
+{
+}
+
+std::string_view Logger::TimeStampCache::Get(uint64_t fileTime)
+{
+	// The FILETIME values are in 100-nanosecond intervals.
+	const uint64_t second = fileTime / 10000000;
+
+	if (second != cachedSecond)
+	{
+		cachedSecond = second;
+		length = static_cast<uint32_t>(FormatTimeStamp(fileTime, text, sizeof(text)));
+	}
+
+	return std::string_view(text, length);
 }
 
 Logger& Logger::GetInstance()
@@ -55,16 +101,35 @@ Logger& Logger::GetInstance()
 	return logger;
 }
 
-Logger::Logger() : initialized(false), logFile(), logLevel(LogLevel::Error)
+Logger::Logger()
+	: initialized(false),
+	  logLevel(LogLevel::Error),
+	  logFile(),
+	  asyncWriterRunning(false),
+	  activeProducers(0),
+	  overflowPolicy(LogOverflowPolicy::Drop),
+	  recordQueue(),
+	  droppedLineCount(0),
+	  stopRequested(false),
+	  writerMutex(),
+	  writerCondition(),
+	  writerThread(),
+	  syncTimeStampCache(),
+	  asyncTimeStampCache()
 {
 }
 
 Logger::~Logger()
 {
+	Shutdown();
 	initialized = false;
 }
 
-void Logger::Init(std::filesystem::path logFilePath, LogLevel options)
+void Logger::Init(
+	std::filesystem::path logFilePath,
+	LogLevel options,
+	LogWriteMode writeMode,
+	LogOverflowPolicy overflowPolicy)
 {
 	if (!initialized)
 	{
@@ -72,19 +137,51 @@ void Logger::Init(std::filesystem::path logFilePath, LogLevel options)
 
 		logFile.open(logFilePath, std::ofstream::out | std::ofstream::trunc);
 		logLevel = options;
+
+		if (writeMode == LogWriteMode::Asynchronous && logFile)
+		{
+			this->overflowPolicy = overflowPolicy;
+			recordQueue = std::make_unique<MpscRingBuffer<LogRecord, LogRecordQueueCapacity>>();
+			stopRequested.store(false, std::memory_order_relaxed);
+			writerThread = std::thread(&Logger::BackgroundWriterThread, this);
+			asyncWriterRunning.store(true, std::memory_order_release);
+		}
 	}
 }
 
-bool Logger::IsEnabled(LogLevel level) const
+void Logger::Shutdown()
 {
-	return logLevel >= level;
+	if (asyncWriterRunning.exchange(false))
+	{
+		// Wait for the producers that saw the writer running to finish their push,
+		// the background thread keeps draining the queue in the meantime.
+		while (activeProducers.load(std::memory_order_acquire) != 0)
+		{
+			std::this_thread::yield();
+		}
+
+		// The background thread writes all of the queued records before it exits.
+		stopRequested.store(true, std::memory_order_release);
+		writerCondition.notify_one();
+		writerThread.join();
+
+		const uint64_t droppedLines = droppedLineCount.load(std::memory_order_relaxed);
+
+		if (droppedLines > 0 && logFile)
+		{
+			logFile << "Dropped " << droppedLines << " log lines because the queue was full." << std::endl;
+		}
+	}
 }
 
 void Logger::WriteLogFileHeader(const char* const text)
 {
 	if (initialized && logFile)
 	{
-		logFile << text << std::endl;
+		if (!TryQueueRecord(text, false))
+		{
+			logFile << text << std::endl;
+		}
 	}
 }
 
@@ -95,50 +192,106 @@ void Logger::WriteLine(LogLevel level, const char* const message)
 		return;
 	}
 
-	WriteLineCore(message);
+	if (!TryQueueRecord(message, true))
+	{
+		WriteLineCore(message);
+	}
 }
 
-void Logger::WriteLineFormatted(LogLevel level, const char* const format, ...)
+uint64_t Logger::GetDroppedLineCount() const
 {
-	if (!IsEnabled(level))
+	return droppedLineCount.load(std::memory_order_relaxed);
+}
+
+void Logger::WriteLineCore(const char* const message)
+{
+	if (initialized && logFile)
 	{
-		return;
+		const std::string_view timeStamp = syncTimeStampCache.Get(GetCurrentFileTime());
+
+#ifdef _DEBUG
+		PrintLineToDebugOutput(timeStamp.data(), message);
+#endif // _DEBUG
+
+		logFile << timeStamp << message << std::endl;
 	}
+}
 
-	va_list args;
-	va_start(args, format);
+bool Logger::TryQueueRecord(const char* const message, bool includeTimeStamp)
+{
+	return TryQueueRecord(includeTimeStamp, [message](char* buffer, size_t bufferSize)
+	{
+		const size_t length = std::min(std::strlen(message), bufferSize);
 
-	va_list argsCopy;
-	va_copy(argsCopy, args);
+		std::memcpy(buffer, message, length);
 
-	int formattedStringLength = std::vsnprintf(nullptr, 0, format, argsCopy);
+		return length;
+	});
+}
 
-	va_end(argsCopy);
+uint64_t Logger::GetCurrentFileTime()
+{
+	FILETIME time{};
+	GetSystemTimeAsFileTime(&time);
+
+	return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+}
 
-	if (formattedStringLength > 0)
+void Logger::BackgroundWriterThread()
+{
+	auto lastFlushTime = std::chrono::steady_clock::now();
+	bool hasUnflushedLines = false;
+
+	LogRecord record{};
+
+	while (true)
 	{
-		size_t formattedStringLengthWithNull = static_cast<size_t>(formattedStringLength) + 1;
+		// The stop flag must be read before the queue is drained, any record that
+		// was queued before the flag was set is then guaranteed to be written.
+		const bool stopping = stopRequested.load(std::memory_order_acquire);
 
-		std::unique_ptr<char[]> buffer = std::make_unique_for_overwrite<char[]>(formattedStringLengthWithNull);
+		while (recordQueue->TryPop(record))
+		{
+			WriteRecord(record);
+			hasUnflushedLines = true;
+		}
 
-		std::vsnprintf(buffer.get(), formattedStringLengthWithNull, format, args);
+		const auto now = std::chrono::steady_clock::now();
 
-		WriteLineCore(buffer.get());
-	}
+		if (hasUnflushedLines && (stopping || (now - lastFlushTime) >= kFlushInterval))
+		{
+			logFile.flush();
+			lastFlushTime = now;
+			hasUnflushedLines = false;
+		}
 
-	va_end(args);
+		if (stopping)
+		{
+			break;
+		}
+
+		std::unique_lock<std::mutex> lock(writerMutex);
+
+		writerCondition.wait_for(
+			lock,
+			kWriterWaitTimeout,
+			[this]() { return stopRequested.load(std::memory_order_acquire) || !recordQueue->IsEmpty(); });
+	}
 }
 
-void Logger::WriteLineCore(const char* const message)
+void Logger::WriteRecord(const LogRecord& record)
 {
-	if (initialized && logFile)
+	if (record.includeTimeStamp)
 	{
-		std::string timeStamp = GetTimeStamp();
+		const std::string_view timeStamp = asyncTimeStampCache.Get(record.fileTime);
 
 #ifdef _DEBUG
-		PrintLineToDebugOutput(timeStamp.c_str(), message);
+		PrintLineToDebugOutput(timeStamp.data(), record.text);
 #endif // _DEBUG
 
-		logFile << timeStamp << message << std::endl;
+		logFile << timeStamp;
 	}
-}
\ No newline at end of file
+
+	logFile.write(record.text, record.length);
+	logFile.put('\n');
+}
@@ -11,8 +11,16 @@
 //////////////////////////////////////////////////////////////////////////
 
 #pragma once
+#include "MpscRingBuffer.h"
+#include <atomic>
+#include <condition_variable>
 #include <filesystem>
+#include <format>
 #include <fstream>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <utility>
 
 enum class LogLevel : int32_t
 {
@@ -22,31 +30,214 @@ enum class LogLevel : int32_t
 	Trace = 3
 };
 
+enum class LogWriteMode : int32_t
+{
+	// The log lines are written to the file on the calling thread.
+	Synchronous = 0,
+	// The log lines are queued and written to the file by a background thread.
+	Asynchronous = 1
+};
+
+enum class LogOverflowPolicy : int32_t
+{
+	// The log line is discarded when the queue is full.
+	Drop = 0,
+	// The calling thread waits until the background thread has room in the queue.
+	Block = 1
+};
+
 class Logger
 {
 public:
 
 	static Logger& GetInstance();
 
-	void Init(std::filesystem::path logFilePath, LogLevel logLevel);
+	void Init(
+		std::filesystem::path logFilePath,
+		LogLevel logLevel,
+		LogWriteMode writeMode = LogWriteMode::Synchronous,
+		LogOverflowPolicy overflowPolicy = LogOverflowPolicy::Drop);
 
-	bool IsEnabled(LogLevel option) const;
+	/**
+	 * @brief Writes any queued log lines and stops the background thread.
+	 */
+	void Shutdown();
+
+	bool IsEnabled(LogLevel level) const
+	{
+		return logLevel >= level;
+	}
 
 	void WriteLogFileHeader(const char* const message);
 
 	void WriteLine(LogLevel level, const char* const message);
 
-	void WriteLineFormatted(LogLevel level, const char* const format, ...);
+	/**
+	 * @brief Writes a line that is formatted using std::format.
+	 *
+	 * The format string is checked at compile time, and the line is formatted into a
+	 * fixed-size buffer without allocating memory. Lines that are longer than the buffer
+	 * are truncated.
+	 *
+	 * The arguments are evaluated even if the log level is disabled, use the LOG_WRITE_LINE
+	 * macro when the arguments are expensive to compute.
+	 */
+	template <typename... TArgs>
+	void WriteLine(LogLevel level, std::format_string<TArgs...> format, TArgs&&... args)
+	{
+		if (!IsEnabled(level))
+		{
+			return;
+		}
+
+		const auto writeText = [&](char* buffer, size_t bufferSize)
+		{
+			return static_cast<size_t>(std::format_to_n(
+				buffer,
+				static_cast<std::ptrdiff_t>(bufferSize),
+				format,
+				std::forward<TArgs>(args)...).out - buffer);
+		};
+
+		if (!TryQueueRecord(true, writeText))
+		{
+			char buffer[1024];
+
+			const size_t length = writeText(buffer, sizeof(buffer) - 1);
+			buffer[length] = '\0';
+
+			WriteLineCore(buffer);
+		}
+	}
+
+	uint64_t GetDroppedLineCount() const;
 
 private:
 
+	struct LogRecord
+	{
+		// The time that the line was logged, in the Windows FILETIME format.
+		uint64_t fileTime;
+		uint32_t length;
+		bool includeTimeStamp;
+		char text[499];
+	};
+
+	static constexpr size_t LogRecordQueueCapacity = 1024;
+
 	Logger();
 	~Logger();
 
 	void WriteLineCore(const char* const message);
 
+	bool TryQueueRecord(const char* const message, bool includeTimeStamp);
+
+	/**
+	 * @brief Queues a record for the background thread.
+	 * @param includeTimeStamp True if the line is prefixed with a time stamp.
+	 * @param writeText A function that writes the text into the record, it is called
+	 * with the buffer and its size and returns the number of characters written.
+	 * @return True if the record was queued or dropped, or false if the background
+	 * thread is not running and the caller must write the line itself.
+	 */
+	template <typename TWriteText>
+	bool TryQueueRecord(bool includeTimeStamp, TWriteText&& writeText)
+	{
+		// Shutdown waits until this count is zero before it stops the background thread,
+		// so a record that is pushed after the running flag was checked is still written.
+		// Both atomics use sequentially consistent ordering, either Shutdown sees this
+		// producer or the producer sees that the writer has stopped.
+		activeProducers.fetch_add(1);
+
+		if (!asyncWriterRunning.load())
+		{
+			activeProducers.fetch_sub(1, std::memory_order_release);
+			return false;
+		}
+
+		const uint64_t fileTime = includeTimeStamp ? GetCurrentFileTime() : 0;
+
+		const auto fillRecord = [&](LogRecord& record)
+		{
+			const size_t length = writeText(record.text, sizeof(record.text) - 1);
+
+			record.fileTime = fileTime;
+			record.length = static_cast<uint32_t>(length);
+			record.includeTimeStamp = includeTimeStamp;
+			record.text[length] = '\0';
+		};
+
+		while (!recordQueue->TryPush(fillRecord))
+		{
+			if (overflowPolicy == LogOverflowPolicy::Drop)
+			{
+				droppedLineCount.fetch_add(1, std::memory_order_relaxed);
+				activeProducers.fetch_sub(1, std::memory_order_release);
+				return true;
+			}
+
+			writerCondition.notify_one();
+			std::this_thread::yield();
+		}
+
+		writerCondition.notify_one();
+		activeProducers.fetch_sub(1, std::memory_order_release);
+		return true;
+	}
+
+	static uint64_t GetCurrentFileTime();
+
+	void BackgroundWriterThread();
+
+	void WriteRecord(const LogRecord& record);
+
+	/**
+	 * @brief Formats the time stamp that prefixes a log line.
+	 *
+	 * The time stamp only has a resolution of one second, so the formatted
+	 * value is reused until the second changes.
+	 */
+	class TimeStampCache
+	{
+	public:
+		TimeStampCache();
+
+		std::string_view Get(uint64_t fileTime);
+
+	private:
+		uint64_t cachedSecond;
+		uint32_t length;
+		char text[128];
+	};
+
 	bool initialized;
 	LogLevel logLevel;
 	std::ofstream logFile;
+	std::atomic<bool> asyncWriterRunning;
+	std::atomic<uint32_t> activeProducers;
+	LogOverflowPolicy overflowPolicy;
+	std::unique_ptr<MpscRingBuffer<LogRecord, LogRecordQueueCapacity>> recordQueue;
+	std::atomic<uint64_t> droppedLineCount;
+	std::atomic<bool> stopRequested;
+	std::mutex writerMutex;
+	std::condition_variable writerCondition;
+	std::thread writerThread;
+	// The synchronous writer and the background thread each use their own cache.
+	TimeStampCache syncTimeStampCache;
+	TimeStampCache asyncTimeStampCache;
 };
 
+/**
+ * @brief Writes a formatted line if the log level is enabled.
+ *
+ * The format arguments are not evaluated when the log level is disabled.
+ */
+#define LOG_WRITE_LINE(level, format, ...) \
+	do \
+	{ \
+		Logger& logger_ = Logger::GetInstance(); \
+		if (logger_.IsEnabled(level)) \
+		{ \
+			logger_.WriteLine(level, format __VA_OPT__(,) __VA_ARGS__); \
+		} \
+	} while (false)
@@ -10,8 +10,20 @@
 //
 //////////////////////////////////////////////////////////////////////////
 
+#include "ActiveDemandStatistics.h"
+#include "BuildingCensus.h"
+#include "DemandForecast.h"
+#include "DemandHistory.h"
+#include "DemandSnapshot.h"
+#include "DemandVariables.h"
+#include "GlobalValueWriter.h"
+#include "GridSummary.h"
+#include "Instrumentation.h"
+#include "MoreDemandInfoService.h"
+#include "SharedMemoryExport.h"
 #include "Logger.h"
 #include "RegionalCityDataProvider.h"
+#include "SimulatorTickAgent.h"
 #include "version.h"
 #include "cIGZFrameWork.h"
 #include "cIGZApp.h"
@@ -19,8 +31,10 @@
 #include "cISC4AdvisorSystem.h"
 #include "cISC4BudgetSimulator.h"
 #include "cISC4City.h"
-#include "cISC4Demand.h"
 #include "cISC4DemandSimulator.h"
+#include "cISC4LotManager.h"
+#include "cISC4PoliceSimulator.h"
+#include "cISC4PollutionSimulator.h"
 #include "cISC4Simulator.h"
 #include "cIGZMessageServer2.h"
 #include "cIGZMessageTarget.h"
@@ -32,9 +46,11 @@
 #include "cRZBaseString.h"
 #include "GZServPtrs.h"
 #include <array>
+#include <bit>
 #include <filesystem>
 #include <memory>
 #include <string>
+#include <utility>
 #include <Windows.h>
 #include "wil/resource.h"
 #include "wil/filesystem.h"
@@ -44,24 +60,20 @@ static constexpr uint32_t kSC4MessagePostCityInit = 0x26D31EC1;
 static constexpr uint32_t kSC4MessagePostSave = 0x26C63345;
 static constexpr uint32_t kSC4MessagePreCityShutdown = 0x26D31EC2;
 static constexpr uint32_t kSC4MessageSimNewMonth = 0x66956816;
+static constexpr uint32_t kSC4MessageInsertOccupant = 0x99EF1142;
+static constexpr uint32_t kSC4MessageRemoveOccupant = 0x99EF1143;
 
-static constexpr std::array<uint32_t, 5> RequiredNotifications =
+static constexpr std::array<uint32_t, 7> RequiredNotifications =
 {
 	kSC4MessageActiveDemandChanged,
 	kSC4MessagePostCityInit,
 	kSC4MessagePreCityShutdown,
 	kSC4MessagePostSave,
 	kSC4MessageSimNewMonth,
+	kSC4MessageInsertOccupant,
+	kSC4MessageRemoveOccupant,
 };
 
-static constexpr uint32_t kCs1DemandID = 0x3110;
-static constexpr uint32_t kCs2DemandID = 0x3120;
-static constexpr uint32_t kCs3DemandID = 0x3130;
-static constexpr uint32_t kIRDemandID = 0x4100;
-static constexpr uint32_t kIDDemandID = 0x4200;
-static constexpr uint32_t kIMDemandID = 0x4300;
-static constexpr uint32_t kIHTDemandID = 0x4400;
-
 static constexpr std::array<std::pair<int32_t, const char*>, 12> RCIGroupTaxIncomeVariables =
 {
 	// The first value is the index that is used to retrieve the data from the budget simulator.
@@ -80,7 +92,206 @@ static constexpr std::array<std::pair<int32_t, const char*>, 12> RCIGroupTaxInco
 	std::pair(11, "g_tax_income_i_hightech"),
 };
 
-static constexpr uint32_t kTotalsDemandIndex = 0x20000;
+static constexpr std::array<const char*, RCIGroupTaxIncomeVariables.size()> RCIGroupTaxIncomeAverageVariables =
+{
+	// The average of the last kDemandHistoryAverageMonths values of the RCIGroupTaxIncomeVariables entry
+	// with the same index.
+	"g_tax_income_r_low_12mo_avg",
+	"g_tax_income_r_med_12mo_avg",
+	"g_tax_income_r_high_12mo_avg",
+	"g_tax_income_cs_low_12mo_avg",
+	"g_tax_income_cs_med_12mo_avg",
+	"g_tax_income_cs_high_12mo_avg",
+	"g_tax_income_co_med_12mo_avg",
+	"g_tax_income_co_high_12mo_avg",
+	"g_tax_income_i_resource_12mo_avg",
+	"g_tax_income_i_dirty_12mo_avg",
+	"g_tax_income_i_manufacturing_12mo_avg",
+	"g_tax_income_i_hightech_12mo_avg",
+};
+
+static constexpr std::array<std::pair<int64_t PopulationTotals::*, const char*>, 12> RegionPopulationVariables =
+{
+	// The first value is the PopulationTotals field that the value is read from.
+	// The second value is the variable name that SC4 will add to the Lua game table.
+	std::pair(&PopulationTotals::res1Pop, "g_region_r1_population"),
+	std::pair(&PopulationTotals::res2Pop, "g_region_r2_population"),
+	std::pair(&PopulationTotals::res3Pop, "g_region_r3_population"),
+	std::pair(&PopulationTotals::cs1Pop, "g_region_cs1_population"),
+	std::pair(&PopulationTotals::cs2Pop, "g_region_cs2_population"),
+	std::pair(&PopulationTotals::cs3Pop, "g_region_cs3_population"),
+	std::pair(&PopulationTotals::co2Pop, "g_region_co2_population"),
+	std::pair(&PopulationTotals::co3Pop, "g_region_co3_population"),
+	std::pair(&PopulationTotals::irPop, "g_region_ir_population"),
+	std::pair(&PopulationTotals::idPop, "g_region_id_population"),
+	std::pair(&PopulationTotals::imPop, "g_region_im_population"),
+	std::pair(&PopulationTotals::ihtPop, "g_region_iht_population"),
+};
+
+static constexpr std::array<const char*, RCIGroupTaxIncomeVariables.size()> RCIGroupTaxIncomeTextVariables =
+{
+	// The display string of the RCIGroupTaxIncomeVariables entry with the same index, e.g. §12,340/mo.
+	"g_tax_income_r_low_text",
+	"g_tax_income_r_med_text",
+	"g_tax_income_r_high_text",
+	"g_tax_income_cs_low_text",
+	"g_tax_income_cs_med_text",
+	"g_tax_income_cs_high_text",
+	"g_tax_income_co_med_text",
+	"g_tax_income_co_high_text",
+	"g_tax_income_i_resource_text",
+	"g_tax_income_i_dirty_text",
+	"g_tax_income_i_manufacturing_text",
+	"g_tax_income_i_hightech_text",
+};
+
+static constexpr std::array<const char*, RegionPopulationVariables.size()> RegionPopulationTextVariables =
+{
+	// The display string of the RegionPopulationVariables entry with the same index, e.g. 1.24M.
+	"g_region_r1_population_text",
+	"g_region_r2_population_text",
+	"g_region_r3_population_text",
+	"g_region_cs1_population_text",
+	"g_region_cs2_population_text",
+	"g_region_cs3_population_text",
+	"g_region_co2_population_text",
+	"g_region_co3_population_text",
+	"g_region_ir_population_text",
+	"g_region_id_population_text",
+	"g_region_im_population_text",
+	"g_region_iht_population_text",
+};
+
+static constexpr std::array<std::pair<int64_t PopulationTotals::*, const char*>, 12> NearbyPopulationVariables =
+{
+	// The first value is the PopulationTotals field that the value is read from.
+	// The second value is the variable name that SC4 will add to the Lua game table.
+	std::pair(&PopulationTotals::res1Pop, "g_nearby_r1_population"),
+	std::pair(&PopulationTotals::res2Pop, "g_nearby_r2_population"),
+	std::pair(&PopulationTotals::res3Pop, "g_nearby_r3_population"),
+	std::pair(&PopulationTotals::cs1Pop, "g_nearby_cs1_population"),
+	std::pair(&PopulationTotals::cs2Pop, "g_nearby_cs2_population"),
+	std::pair(&PopulationTotals::cs3Pop, "g_nearby_cs3_population"),
+	std::pair(&PopulationTotals::co2Pop, "g_nearby_co2_population"),
+	std::pair(&PopulationTotals::co3Pop, "g_nearby_co3_population"),
+	std::pair(&PopulationTotals::irPop, "g_nearby_ir_population"),
+	std::pair(&PopulationTotals::idPop, "g_nearby_id_population"),
+	std::pair(&PopulationTotals::imPop, "g_nearby_im_population"),
+	std::pair(&PopulationTotals::ihtPop, "g_nearby_iht_population"),
+};
+
+static constexpr std::array<std::array<const char*, 4>, RegionEconomyMetricCount> RegionEconomyVariables =
+{
+	// The rows are in RegionEconomyMetric order, and the columns are the variable names
+	// for the total, mean, minimum and maximum of the established cities in the region.
+	std::array<const char*, 4>{ "g_region_budget_total", "g_region_budget_avg", "g_region_budget_min", "g_region_budget_max" },
+	std::array<const char*, 4>{ "g_region_income_total", "g_region_income_avg", "g_region_income_min", "g_region_income_max" },
+	std::array<const char*, 4>{ "g_region_population_total", "g_region_population_avg", "g_region_population_min", "g_region_population_max" },
+	std::array<const char*, 4>{ "g_region_commercial_jobs_total", "g_region_commercial_jobs_avg", "g_region_commercial_jobs_min", "g_region_commercial_jobs_max" },
+	std::array<const char*, 4>{ "g_region_industrial_jobs_total", "g_region_industrial_jobs_avg", "g_region_industrial_jobs_min", "g_region_industrial_jobs_max" },
+	std::array<const char*, 4>{ "g_region_workforce_percentage_total", "g_region_workforce_percentage_avg", "g_region_workforce_percentage_min", "g_region_workforce_percentage_max" },
+};
+
+static constexpr std::array<std::array<const char*, 4>, DemandVariables::Count> BuildingCensusVariables =
+{
+	// The rows are in DemandVariables table order, and the columns are the variable names
+	// for the building count, capacity, occupancy and vacancy of the group.
+	std::array<const char*, 4>{ "g_r1_building_count", "g_r1_capacity", "g_r1_occupancy", "g_r1_vacant_housing" },
+	std::array<const char*, 4>{ "g_r2_building_count", "g_r2_capacity", "g_r2_occupancy", "g_r2_vacant_housing" },
+	std::array<const char*, 4>{ "g_r3_building_count", "g_r3_capacity", "g_r3_occupancy", "g_r3_vacant_housing" },
+	std::array<const char*, 4>{ "g_cs1_building_count", "g_cs1_capacity", "g_cs1_occupancy", "g_cs1_vacant_jobs" },
+	std::array<const char*, 4>{ "g_cs2_building_count", "g_cs2_capacity", "g_cs2_occupancy", "g_cs2_vacant_jobs" },
+	std::array<const char*, 4>{ "g_cs3_building_count", "g_cs3_capacity", "g_cs3_occupancy", "g_cs3_vacant_jobs" },
+	std::array<const char*, 4>{ "g_co2_building_count", "g_co2_capacity", "g_co2_occupancy", "g_co2_vacant_jobs" },
+	std::array<const char*, 4>{ "g_co3_building_count", "g_co3_capacity", "g_co3_occupancy", "g_co3_vacant_jobs" },
+	std::array<const char*, 4>{ "g_ir_building_count", "g_ir_capacity", "g_ir_occupancy", "g_ir_vacant_jobs" },
+	std::array<const char*, 4>{ "g_id_building_count", "g_id_capacity", "g_id_occupancy", "g_id_vacant_jobs" },
+	std::array<const char*, 4>{ "g_im_building_count", "g_im_capacity", "g_im_occupancy", "g_im_vacant_jobs" },
+	std::array<const char*, 4>{ "g_iht_building_count", "g_iht_capacity", "g_iht_occupancy", "g_iht_vacant_jobs" },
+};
+
+// The simulation grids that are summarized each month.
+enum class SummarizedGrid : size_t
+{
+	AirPollution = 0,
+	WaterPollution,
+	Garbage,
+	PoliceCoverage,
+	Count
+};
+
+static constexpr size_t SummarizedGridCount = static_cast<size_t>(SummarizedGrid::Count);
+
+static constexpr std::array<std::string_view, SummarizedGridCount> GridSummaryVariablePrefixes =
+{
+	// The summary variable names are the prefix followed by a suffix, e.g. g_air_pollution_p50.
+	"g_air_pollution",
+	"g_water_pollution",
+	"g_garbage",
+	"g_police_coverage",
+};
+
+// The writes to a Lua global variable are skipped when the new value is within
+// the deadband of the last value that was written.
+static constexpr GlobalValueDeadbandMode kGlobalValueDeadbandMode = GlobalValueDeadbandMode::Exact;
+static constexpr double kGlobalValueDeadbandEpsilon = 0.0;
+
+// SC4 sends many ActiveDemandChanged messages per simulation tick. When this option is enabled
+// the message handler only records which demand groups changed, and those groups are updated
+// once per tick by a simulator agent.
+static constexpr bool kCoalesceActiveDemandChanges = true;
+
+// The tick semantics of the simulator agent type are not documented. When this many
+// ActiveDemandChanged messages arrive without a simulator tick, the plugin removes the
+// agent and updates the demand groups for every message instead.
+static constexpr uint32_t kMaxActiveDemandChangesWithoutTick = 256;
+
+// The g_nearby_* variables include the regional cities that are within this many small city
+// tiles of the current city, a distance of 1 includes the adjacent cities.
+static constexpr uint32_t kNearbyCityDistance = 1;
+
+// When the plugin is built with instrumentation, this option publishes the statistics
+// as g_moredemand_stats_* variables each month.
+static constexpr bool kPublishInstrumentationStats = false;
+
+// When this option is enabled the values of the cISC4MoreDemandInfo interface are copied to
+// a named shared memory block that external tools can read, see SharedMemoryExport.h.
+static constexpr bool kExportSharedMemory = false;
+
+// When this option is enabled the region population and tax income values are also
+// published as formatted strings for UI placeholder text, e.g. g_region_r1_population_text.
+static constexpr bool kPublishDisplayStrings = true;
+
+// The number of buildings that the building census re-reads on each simulator tick, the
+// occupancy of a building changes without a message so the census cycles through the city.
+static constexpr size_t kBuildingCensusRefreshCount = 64;
+
+// When this option is enabled the pollution and police coverage grids are summarized at the
+// start of each month, and published as g_<grid>_avg, _p50, _tile_<x><z> and _hist_<bin> values.
+static constexpr bool kPublishGridSummaries = true;
+
+// When this option is enabled the active demand values are also published as a moving average,
+// the minimum and maximum of the recent values and the trend of the recent values, e.g. g_cs1_active_demand_ema.
+static constexpr bool kPublishActiveDemandStatistics = true;
+// The weight of each new active demand value in the exponential moving average.
+static constexpr double kActiveDemandEmaSmoothing = 0.1;
+
+// When this option is enabled the plugin records the demand, tax income and regional population
+// values each month, the history is stored next to the city's save file.
+static constexpr bool kPersistDemandHistory = true;
+static constexpr size_t kDemandHistoryAverageMonths = 12;
+
+// When this option is enabled the plugin publishes a forecast of each group's demand,
+// e.g. g_ir_demand_forecast_6mo, with the bounds of an approximate 95% confidence interval.
+static constexpr bool kPublishDemandForecast = true;
+static constexpr DemandForecastParameters kDemandForecastParameters =
+{
+	0.3f, // levelSmoothing
+	0.1f, // trendSmoothing
+	0.2f, // seasonalSmoothing
+	0.1f, // errorSmoothing
+};
+static constexpr float kDemandForecastIntervalScale = 1.96f;
 
 static constexpr uint32_t kGZIID_cISC4App = 0x26ce01c0;
 
@@ -88,21 +299,65 @@ static constexpr uint32_t kMoreDemandInfoPluginDirectorID = 0x9E06B67E;
 
 static constexpr std::string_view PluginLogFileName = "SC4MoreDemandInfo.log";
 
+struct DemandVariableShadows
+{
+	GlobalValueShadow activeDemand;
+	GlobalValueShadow demand;
+	GlobalValueShadow demandCap;
+};
+
 class MoreDemandInfoDllDirector : public cRZMessage2COMDirector
 {
 public:
 
 	MoreDemandInfoDllDirector()
-		: pAdvisorSystem(nullptr),
+		: pCity(nullptr),
+		  pAdvisorSystem(nullptr),
+		  pBudgetSim(nullptr),
 		  pDemandSim(nullptr),
-		  firstCs1DemandUpdate(true),
-		  firstCs2DemandUpdate(true),
-		  firstCs3DemandUpdate(true),
-		  firstIRDemandUpdate(true),
-		  firstIDDemandUpdate(true),
-		  firstIMDemandUpdate(true),
-		  firstIHTDemandUpdate(true)
+		  pSimulator(nullptr),
+		  pPollutionSim(nullptr),
+		  pPoliceSim(nullptr),
+		  regionalCityDataProvider(),
+		  demandSnapshot(),
+		  buildingCensus(),
+		  buildingCensusShadows(),
+		  gridSummarizer(),
+		  gridSummaryVariableNames(),
+		  gridSummaryShadows(),
+		  globalValueWriter(kGlobalValueDeadbandMode, kGlobalValueDeadbandEpsilon),
+		  demandShadows(),
+		  regionPopulationShadows(),
+		  regionPopulationTextShadows(),
+		  nearbyPopulationShadows(),
+		  regionEconomyShadows(),
+		  taxIncome(),
+		  taxIncomeShadows(),
+		  taxIncomeTextShadows(),
+		  taxIncomeAverageShadows(),
+		  demandHistory(),
+		  demandForecast(kDemandForecastParameters),
+		  demandForecastShadows(),
+		  simulatorTickAgent([this]() { SimulatorTick(); }),
+		  dirtyDemandSlots(0),
+		  buildingCensusChanged(false),
+		  firstDemandUpdate(),
+		  simulatorTickCount(0),
+		  activeDemandChangesSinceTick(0),
+		  activeDemandStatistics(),
+		  activeDemandStatisticShadows(),
+		  moreDemandInfoService(),
+		  sharedMemoryExport()
 	{
+		firstDemandUpdate.fill(true);
+
+		for (size_t i = 0; i < SummarizedGridCount; i++)
+		{
+			gridSummaryVariableNames[i] = CreateGridSummaryVariableNames(GridSummaryVariablePrefixes[i]);
+		}
+
+		AddCls(GZCLSID_cISC4MoreDemandInfo, GetMoreDemandInfoClassObject);
+
 		std::filesystem::path dllFolder = GetDllFolderPath();
 
 		std::filesystem::path logFilePath = dllFolder;
@@ -110,7 +365,7 @@ public:
 
 		Logger& logger = Logger::GetInstance();
 
-		logger.Init(logFilePath, LogLevel::Error);
+		logger.Init(logFilePath, LogLevel::Error, LogWriteMode::Asynchronous, LogOverflowPolicy::Drop);
 		logger.WriteLogFileHeader("SC4MoreDemandInfo v" PLUGIN_VERSION_STR);
 	}
 
@@ -119,354 +374,752 @@ public:
 		return kMoreDemandInfoPluginDirectorID;
 	}
 
-	void UpdateCs1Demand()
+	static bool GetMoreDemandInfoClassObject(uint32_t riid, void** ppvObj)
+	{
+		// Other plugins share the director's instance, so they read the same values
+		// that the plugin writes to the Lua game table without computing them again.
+		MoreDemandInfoDllDirector* pDirector = static_cast<MoreDemandInfoDllDirector*>(RZGetCOMDllDirector());
+
+		return pDirector->moreDemandInfoService.QueryInterface(riid, ppvObj);
+	}
+
+	template <size_t Slot>
+	void UpdateDemandVariables()
 	{
-		if (pAdvisorSystem && pDemandSim)
+		static constexpr DemandVariableInfo Info = DemandVariables::Table[Slot];
+
+		const DemandSnapshotData& snapshot = demandSnapshot.GetCurrent();
+
+		if (pAdvisorSystem && (snapshot.validSlots & (1U << Slot)) != 0)
 		{
-			const cISC4Demand* pDemand = pDemandSim->GetDemand(kCs1DemandID, kTotalsDemandIndex);
+			const DemandValues& values = snapshot.groups[Slot];
+			DemandVariableShadows& shadows = demandShadows[Slot];
 
-			if (pDemand)
+			moreDemandInfoService.SetDemandGroup(Slot, Info.demandID, values.activeDemand, values.demand, values.demandCap);
+
+			if constexpr (HasFlag(Info.flags, DemandVariableFlags::ActiveDemand))
 			{
-				// The SetGlobalValue method will add the value to the LUA scripting system.
-				// It can be accessed from a script or UI placeholder text using game.<value name>.
+				globalValueWriter.SetGlobalValue(shadows.activeDemand, Info.activeDemandVariableName, values.activeDemand);
 
-				const float activeDemand = pDemand->QueryActiveDemandValue();
-				pAdvisorSystem->SetGlobalValue("g_cs1_active_demand", activeDemand);
+				if (kPublishActiveDemandStatistics)
+				{
+					UpdateActiveDemandStatistics<Slot>(values.activeDemand);
+				}
+			}
 
-				const float demand = pDemand->QueryDemandValue();
-				pAdvisorSystem->SetGlobalValue("g_cs1_demand", demand);
+			if constexpr (HasFlag(Info.flags, DemandVariableFlags::Demand))
+			{
+				globalValueWriter.SetGlobalValue(shadows.demand, Info.demandVariableName, values.demand);
+			}
 
-				if (firstCs1DemandUpdate)
-				{
-					firstCs1DemandUpdate = false;
+			if constexpr (HasFlag(Info.flags, DemandVariableFlags::DemandCap))
+			{
+				// Convert the cap value from the range of [0, 1] to [0, 100].
+				const float normalizedCapValue = values.demandCap * 100.0f;
 
-					// SC4 frequently updates the active demand values, so we only log the first
-					// one to show that the plugin is working.
+				globalValueWriter.SetGlobalValue(shadows.demandCap, Info.demandCapVariableName, normalizedCapValue);
+			}
 
-					Logger& logger = Logger::GetInstance();
+			if (firstDemandUpdate[Slot])
+			{
+				firstDemandUpdate[Slot] = false;
 
-					logger.WriteLine(
-						LogLevel::Info,
-						"Set the cs1 demand variables.");
-				}
+				// SC4 frequently updates the active demand values, so we only log the first
+				// one to show that the plugin is working.
+
+				Logger& logger = Logger::GetInstance();
+
+				logger.WriteLine(
+					LogLevel::Info,
+					"Set the {} demand variables.",
+					Info.logName);
 			}
 		}
 	}
 
-	void UpdateCs2Demand()
+	template <size_t Slot>
+	void UpdateActiveDemandStatistics(float activeDemand)
 	{
-		if (pAdvisorSystem && pDemandSim)
-		{
-			const cISC4Demand* pDemand = pDemandSim->GetDemand(kCs1DemandID, kTotalsDemandIndex);
+		using DemandVariables::ActiveDemandStatistic;
+		using DemandVariables::ActiveDemandStatisticVariableName;
+
+		ActiveDemandStatistics& statistics = activeDemandStatistics[Slot];
+
+		// The samples are stamped with the number of simulator ticks, the sample number
+		// is used when the tick agent is not registered.
+		const int64_t time = simulatorTickAgent.IsRegistered()
+			? static_cast<int64_t>(simulatorTickCount)
+			: static_cast<int64_t>(statistics.GetSampleCount());
+
+		statistics.AddSample(time, activeDemand, kActiveDemandEmaSmoothing);
+
+		std::array<GlobalValueShadow, ActiveDemandStatisticCount>& shadows = activeDemandStatisticShadows[Slot];
+
+		globalValueWriter.SetGlobalValue(
+			shadows[static_cast<size_t>(ActiveDemandStatistic::Ema)],
+			ActiveDemandStatisticVariableName<Slot, ActiveDemandStatistic::Ema>.data(),
+			statistics.GetEma());
+		globalValueWriter.SetGlobalValue(
+			shadows[static_cast<size_t>(ActiveDemandStatistic::Min)],
+			ActiveDemandStatisticVariableName<Slot, ActiveDemandStatistic::Min>.data(),
+			statistics.GetMin());
+		globalValueWriter.SetGlobalValue(
+			shadows[static_cast<size_t>(ActiveDemandStatistic::Max)],
+			ActiveDemandStatisticVariableName<Slot, ActiveDemandStatistic::Max>.data(),
+			statistics.GetMax());
+		globalValueWriter.SetGlobalValue(
+			shadows[static_cast<size_t>(ActiveDemandStatistic::Slope)],
+			ActiveDemandStatisticVariableName<Slot, ActiveDemandStatistic::Slope>.data(),
+			statistics.GetSlope());
+	}
 
-			if (pDemand)
-			{
-				// The SetGlobalValue method will add the value to the LUA scripting system.
-				// It can be accessed from a script or UI placeholder text using game.<value name>.
+	using DemandUpdateFunction = void (MoreDemandInfoDllDirector::*)();
+
+	template <size_t... Slots>
+	static constexpr std::array<DemandUpdateFunction, sizeof...(Slots)> CreateDemandUpdateFunctions(std::index_sequence<Slots...>)
+	{
+		return { &MoreDemandInfoDllDirector::UpdateDemandVariables<Slots>... };
+	}
 
-				const float activeDemand = pDemand->QueryActiveDemandValue();
-				pAdvisorSystem->SetGlobalValue("g_cs2_active_demand", activeDemand);
+	void UpdateDemandVariables(size_t slot)
+	{
+		// The update code for each table entry is generated at compile time, so the
+		// message handler only has to perform a table lookup and an indirect call.
+		static constexpr std::array<DemandUpdateFunction, DemandVariables::Count> UpdateFunctions
+			= CreateDemandUpdateFunctions(std::make_index_sequence<DemandVariables::Count>());
 
-				const float demand = pDemand->QueryDemandValue();
-				pAdvisorSystem->SetGlobalValue("g_cs2_demand", demand);
+		(this->*UpdateFunctions[slot])();
+	}
 
-				if (firstCs2DemandUpdate)
-				{
-					firstCs2DemandUpdate = false;
+	void ActiveDemandChanged(cIGZMessage2Standard* pStandardMsg)
+	{
+		uint32_t demandID = static_cast<uint32_t>(pStandardMsg->GetData1());
 
-					// SC4 frequently updates the active demand values, so we only log the first
-					// one to show that the plugin is working.
+		const size_t slot = DemandVariables::GetSlot(demandID);
 
-					Logger& logger = Logger::GetInstance();
+		if (slot != DemandVariables::InvalidSlot)
+		{
+			// The simulator does not tick while it is paused, so those changes are not deferred.
+			if (simulatorTickAgent.IsRegistered() && !pSimulator->IsAnyPaused())
+			{
+				dirtyDemandSlots |= 1U << slot;
 
-					logger.WriteLine(
-						LogLevel::Info,
-						"Set the cs2 demand variables.");
+				if (++activeDemandChangesSinceTick >= kMaxActiveDemandChangesWithoutTick)
+				{
+					StopCoalescingActiveDemandChanges();
 				}
 			}
+			else
+			{
+				demandSnapshot.Capture(1U << slot);
+				UpdateDemandVariables(slot);
+			}
 		}
 	}
 
-	void UpdateCs3Demand()
+	void StopCoalescingActiveDemandChanges()
 	{
-		if (pAdvisorSystem && pDemandSim)
-		{
-			const cISC4Demand* pDemand = pDemandSim->GetDemand(kCs3DemandID, kTotalsDemandIndex);
+		Logger::GetInstance().WriteLine(
+			LogLevel::Error,
+			"The simulator agent did not tick for {} demand changes, the demand variables will be updated for every message.",
+			activeDemandChangesSinceTick);
 
-			if (pDemand)
-			{
-				// The SetGlobalValue method will add the value to the LUA scripting system.
-				// It can be accessed from a script or UI placeholder text using game.<value name>.
+		simulatorTickAgent.Unregister();
+		activeDemandChangesSinceTick = 0;
 
-				const float activeDemand = pDemand->QueryActiveDemandValue();
-				pAdvisorSystem->SetGlobalValue("g_cs3_active_demand", activeDemand);
+		// The statistics were stamped with the tick count, the new samples use the sample number.
+		for (ActiveDemandStatistics& statistics : activeDemandStatistics)
+		{
+			statistics.Reset();
+		}
 
-				const float demand = pDemand->QueryDemandValue();
-				pAdvisorSystem->SetGlobalValue("g_cs3_demand", demand);
+		FlushDirtyDemandGroups();
+		FlushBuildingCensusChanges();
+	}
 
-				if (firstCs3DemandUpdate)
-				{
-					firstCs3DemandUpdate = false;
+	void FlushDirtyDemandGroups()
+	{
+		uint32_t slots = dirtyDemandSlots;
+		dirtyDemandSlots = 0;
 
-					// SC4 frequently updates the active demand values, so we only log the first
-					// one to show that the plugin is working.
+		if (slots != 0)
+		{
+			demandSnapshot.Capture(slots);
+		}
 
-					Logger& logger = Logger::GetInstance();
+		while (slots != 0)
+		{
+			const size_t slot = static_cast<size_t>(std::countr_zero(slots));
+			slots &= slots - 1;
 
-					logger.WriteLine(
-						LogLevel::Info,
-						"Set the cs3 demand variables.");
-				}
-			}
+			UpdateDemandVariables(slot);
 		}
 	}
 
-	void UpdateIRDemand()
+	void BuildingCensusChanged()
 	{
-		if (pAdvisorSystem && pDemandSim)
+		// The building placement messages arrive in bursts, so the values are updated once
+		// on the next simulator tick.
+		if (simulatorTickAgent.IsRegistered())
 		{
-			const cISC4Demand* pDemand = pDemandSim->GetDemand(kIRDemandID, kTotalsDemandIndex);
+			buildingCensusChanged = true;
+		}
+		else
+		{
+			UpdateBuildingCensusValues();
+		}
+	}
 
-			if (pDemand)
-			{
-				// The SetGlobalValue method will add the value to the LUA scripting system.
-				// It can be accessed from a script or UI placeholder text using game.<value name>.
+	void FlushBuildingCensusChanges()
+	{
+		if (buildingCensusChanged)
+		{
+			buildingCensusChanged = false;
+			UpdateBuildingCensusValues();
+		}
+	}
 
-				const float activeDemand = pDemand->QueryActiveDemandValue();
-				pAdvisorSystem->SetGlobalValue("g_ir_active_demand", activeDemand);
+	void SimulatorTick()
+	{
+		simulatorTickCount++;
+		activeDemandChangesSinceTick = 0;
 
-				const float demand = pDemand->QueryDemandValue();
-				pAdvisorSystem->SetGlobalValue("g_ir_demand", demand);
+		FlushDirtyDemandGroups();
 
-				const SC4Percentage* irCap = pDemand->GetDemandCap();
+		if (buildingCensus.RefreshBuildings(kBuildingCensusRefreshCount))
+		{
+			buildingCensusChanged = true;
+		}
 
-				// Convert the IR cap value from the range of [0, 1] to [0, 100].
-				const float normalizedIRCapValue = irCap->percentage * 100.0f;
+		FlushBuildingCensusChanges();
+		PublishMoreDemandInfo();
+	}
 
-				pAdvisorSystem->SetGlobalValue("g_current_ir_cap", normalizedIRCapValue);
+	void PublishMoreDemandInfo()
+	{
+		moreDemandInfoService.CommitChanges();
 
-				if (firstIRDemandUpdate)
-				{
-					firstIRDemandUpdate = false;
+		if (kExportSharedMemory)
+		{
+			sharedMemoryExport.Write(moreDemandInfoService);
+		}
+	}
 
-					// SC4 frequently updates the active demand values, so we only log the first
-					// one to show that the plugin is working.
+	void UpdateDemandValues()
+	{
+		// Any pending changes are included in the full update.
+		dirtyDemandSlots = 0;
 
-					Logger& logger = Logger::GetInstance();
+		demandSnapshot.CaptureAll();
 
-					logger.WriteLine(
-						LogLevel::Info,
-						"Set the IR (I-Ag) demand and cap variables.");
-				}
-			}
+		for (size_t i = 0; i < DemandVariables::Count; i++)
+		{
+			UpdateDemandVariables(i);
 		}
 	}
 
-	void UpdateIDDemand()
+	void UpdateRCIGroupPopulationValues()
 	{
-		if (pAdvisorSystem && pDemandSim)
+		if (pAdvisorSystem)
 		{
-			const cISC4Demand* pDemand = pDemandSim->GetDemand(kIDDemandID, kTotalsDemandIndex);
+			// The game already includes regional totals for the residential, commercial and industrial
+			// groups, we add regional totals for the 12 RCI subgroups.
+			//
+			// The game's overall RCI population values may come from a different source than our totals for
+			// the individual groups, but that should be fine as the overall total rarely if ever equals the
+			// sum of the individual group totals.
+
+			const PopulationTotals& totals = regionalCityDataProvider.GetRegionTotalPopulation();
 
-			if (pDemand)
+			moreDemandInfoService.SetRegionPopulation(totals);
+
+			for (size_t i = 0; i < RegionPopulationVariables.size(); i++)
 			{
-				// The SetGlobalValue method will add the value to the LUA scripting system.
-				// It can be accessed from a script or UI placeholder text using game.<value name>.
-				const float demand = pDemand->QueryDemandValue();
-				pAdvisorSystem->SetGlobalValue("g_id_demand", demand);
+				const auto& item = RegionPopulationVariables[i];
+
+				globalValueWriter.SetGlobalValue(
+					regionPopulationShadows[i],
+					item.second,
+					static_cast<double>(totals.*item.first));
 
-				if (firstIDDemandUpdate)
+				if (kPublishDisplayStrings)
 				{
-					firstIDDemandUpdate = false;
+					globalValueWriter.SetGlobalString(
+						regionPopulationTextShadows[i],
+						RegionPopulationTextVariables[i],
+						static_cast<double>(totals.*item.first),
+						DisplayStringFormat::CompactNumber);
+				}
+			}
 
-					// SC4 frequently updates the active demand values, so we only log the first
-					// one to show that the plugin is working.
+			const PopulationTotals nearbyTotals = regionalCityDataProvider.GetNearbyPopulation(kNearbyCityDistance);
 
-					Logger& logger = Logger::GetInstance();
+			moreDemandInfoService.SetNearbyPopulation(nearbyTotals);
 
-					logger.WriteLine(
-						LogLevel::Info,
-						"Set the ID demand variables.");
-				}
+			for (size_t i = 0; i < NearbyPopulationVariables.size(); i++)
+			{
+				const auto& item = NearbyPopulationVariables[i];
+
+				globalValueWriter.SetGlobalValue(
+					nearbyPopulationShadows[i],
+					item.second,
+					static_cast<double>(nearbyTotals.*item.first));
+			}
+
+			const RegionEconomySummary& economySummary = regionalCityDataProvider.GetRegionEconomySummary();
+
+			for (size_t i = 0; i < RegionEconomyVariables.size(); i++)
+			{
+				const auto& names = RegionEconomyVariables[i];
+				const RegionEconomyStatistics& statistics = economySummary.metrics[i];
+				std::array<GlobalValueShadow, 4>& shadows = regionEconomyShadows[i];
+
+				globalValueWriter.SetGlobalValue(shadows[0], names[0], statistics.total);
+				globalValueWriter.SetGlobalValue(shadows[1], names[1], statistics.mean);
+				globalValueWriter.SetGlobalValue(shadows[2], names[2], static_cast<double>(statistics.min));
+				globalValueWriter.SetGlobalValue(shadows[3], names[3], static_cast<double>(statistics.max));
+			}
+		}
+	}
+
+	void UpdateBuildingCensusValues()
+	{
+		if (pAdvisorSystem && buildingCensus.IsInitialized())
+		{
+			const auto& groupTotals = buildingCensus.GetGroupTotals();
+
+			for (size_t i = 0; i < BuildingCensusVariables.size(); i++)
+			{
+				const auto& names = BuildingCensusVariables[i];
+				const BuildingCensusGroupTotals& totals = groupTotals[i];
+				std::array<GlobalValueShadow, 4>& shadows = buildingCensusShadows[i];
+
+				const uint32_t vacancy = totals.capacity > totals.occupancy ? totals.capacity - totals.occupancy : 0;
+
+				globalValueWriter.SetGlobalValue(shadows[0], names[0], static_cast<double>(totals.buildingCount));
+				globalValueWriter.SetGlobalValue(shadows[1], names[1], static_cast<double>(totals.capacity));
+				globalValueWriter.SetGlobalValue(shadows[2], names[2], static_cast<double>(totals.occupancy));
+				globalValueWriter.SetGlobalValue(shadows[3], names[3], static_cast<double>(vacancy));
 			}
 		}
 	}
 
-	void UpdateIMDemand()
+	using PollutionValueFunction = bool (cISC4PollutionSimulator::*)(uint32_t, uint32_t, int16_t&);
+
+	bool SummarizePollution(PollutionValueFunction getValue, GridSummary& summary)
 	{
-		if (pAdvisorSystem && pDemandSim)
+		if (!pCity || !pPollutionSim)
 		{
-			const cISC4Demand* pDemand = pDemandSim->GetDemand(kIMDemandID, kTotalsDemandIndex);
+			return false;
+		}
 
-			if (pDemand)
+		// GetPollutionGrid takes a pollution type id that the SDK does not define, so
+		// the values are read through the typed per-cell methods in city cell coordinates.
+		return gridSummarizer.Summarize(
+			pCity->CellCountX(),
+			pCity->CellCountZ(),
+			[this, getValue](uint32_t x, uint32_t z, float& value)
 			{
-				// The SetGlobalValue method will add the value to the LUA scripting system.
-				// It can be accessed from a script or UI placeholder text using game.<value name>.
-				const float demand = pDemand->QueryDemandValue();
-				pAdvisorSystem->SetGlobalValue("g_im_demand", demand);
+				int16_t cellValue = 0;
 
-				if (firstIMDemandUpdate)
+				if (!(pPollutionSim->*getValue)(x, z, cellValue))
 				{
-					firstIMDemandUpdate = false;
+					return false;
+				}
 
-					// SC4 frequently updates the active demand values, so we only log the first
-					// one to show that the plugin is working.
+				value = static_cast<float>(cellValue);
+				return true;
+			},
+			summary);
+	}
 
-					Logger& logger = Logger::GetInstance();
+	bool SummarizeGrid(SummarizedGrid grid, GridSummary& summary)
+	{
+		INSTRUMENT_SCOPE(InstrumentedCallSite::GridSummary);
 
-					logger.WriteLine(
-						LogLevel::Info,
-						"Set the IM demand variables.");
+		switch (grid)
+		{
+		case SummarizedGrid::AirPollution:
+			return SummarizePollution(&cISC4PollutionSimulator::GetAirValue, summary);
+		case SummarizedGrid::WaterPollution:
+			return SummarizePollution(&cISC4PollutionSimulator::GetWaterValue, summary);
+		case SummarizedGrid::Garbage:
+			return SummarizePollution(&cISC4PollutionSimulator::GetGarbageValue, summary);
+		case SummarizedGrid::PoliceCoverage:
+			if (pPoliceSim)
+			{
+				return gridSummarizer.Summarize(pPoliceSim->GetPolicePowerGrid(), summary);
+			}
+			break;
+		default:
+			break;
+		}
+
+		return false;
+	}
+
+	void UpdateGridSummaryValues()
+	{
+		if (kPublishGridSummaries && pAdvisorSystem)
+		{
+			GridSummary summary{};
+
+			for (size_t i = 0; i < SummarizedGridCount; i++)
+			{
+				if (SummarizeGrid(static_cast<SummarizedGrid>(i), summary))
+				{
+					const std::array<double, kGridSummaryValueCount> values = GetGridSummaryValues(summary);
+					const std::array<std::string, kGridSummaryValueCount>& names = gridSummaryVariableNames[i];
+					std::array<GlobalValueShadow, kGridSummaryValueCount>& shadows = gridSummaryShadows[i];
+
+					for (size_t j = 0; j < kGridSummaryValueCount; j++)
+					{
+						globalValueWriter.SetGlobalValue(shadows[j], names[j].c_str(), values[j]);
+					}
 				}
 			}
 		}
 	}
 
-	void UpdateIHTDemand()
+	void OccupantInserted(cIGZMessage2Standard* pStandardMsg)
 	{
-		if (pAdvisorSystem && pDemandSim)
+		cISC4Occupant* pOccupant = static_cast<cISC4Occupant*>(pStandardMsg->GetVoid1());
+
+		if (buildingCensus.OccupantInserted(pOccupant))
 		{
-			const cISC4Demand* pDemand = pDemandSim->GetDemand(kIHTDemandID, kTotalsDemandIndex);
+			BuildingCensusChanged();
+		}
+	}
 
-			if (pDemand)
+	void OccupantRemoved(cIGZMessage2Standard* pStandardMsg)
+	{
+		cISC4Occupant* pOccupant = static_cast<cISC4Occupant*>(pStandardMsg->GetVoid1());
+
+		if (buildingCensus.OccupantRemoved(pOccupant))
+		{
+			BuildingCensusChanged();
+		}
+	}
+
+	void UpdateRCIGroupTaxIncome()
+	{
+		if (pAdvisorSystem && pBudgetSim)
+		{
+			for (size_t i = 0; i < RCIGroupTaxIncomeVariables.size(); i++)
 			{
-				// The SetGlobalValue method will add the value to the LUA scripting system.
-				// It can be accessed from a script or UI placeholder text using game.<value name>.
-				const float demand = pDemand->QueryDemandValue();
-				pAdvisorSystem->SetGlobalValue("g_iht_demand", demand);
+				const auto& item = RCIGroupTaxIncomeVariables[i];
+
+				taxIncome[i] = INSTRUMENT_CALL(
+					InstrumentedCallSite::GetTaxIncome,
+					pBudgetSim->GetTaxIncome(item.first));
+
+				moreDemandInfoService.SetTaxIncome(i, taxIncome[i]);
+				globalValueWriter.SetGlobalValue(taxIncomeShadows[i], item.second, static_cast<double>(taxIncome[i]));
 
-				if (firstIHTDemandUpdate)
+				if (kPublishDisplayStrings)
 				{
-					firstIHTDemandUpdate = false;
+					globalValueWriter.SetGlobalString(
+						taxIncomeTextShadows[i],
+						RCIGroupTaxIncomeTextVariables[i],
+						static_cast<double>(taxIncome[i]),
+						DisplayStringFormat::MonthlyMoney);
+				}
+			}
+		}
+	}
 
-					// SC4 frequently updates the active demand values, so we only log the first
-					// one to show that the plugin is working.
+	std::filesystem::path GetDemandHistoryFilePath() const
+	{
+		std::filesystem::path path;
 
-					Logger& logger = Logger::GetInstance();
+		if (pCity)
+		{
+			cRZBaseString citySaveFilePath;
 
-					logger.WriteLine(
-						LogLevel::Info,
-						"Set the IHT demand variables.");
-				}
+			if (pCity->GetCitySaveFilePath(citySaveFilePath) && citySaveFilePath.Strlen() > 0)
+			{
+				path = DemandHistory::GetHistoryFilePath(std::filesystem::path(citySaveFilePath.ToChar()));
 			}
 		}
+
+		return path;
 	}
 
-	void ActiveDemandChanged(cIGZMessage2Standard* pStandardMsg)
+	void LoadDemandHistory()
 	{
-		uint32_t demandID = static_cast<uint32_t>(pStandardMsg->GetData1());
+		demandHistory.Clear();
 
-		switch (demandID)
+		if (kPersistDemandHistory && pCity && pSimulator)
 		{
-		case kCs1DemandID:
-			UpdateCs1Demand();
-			break;
-		case kCs2DemandID:
-			UpdateCs2Demand();
-			break;
-		case kCs3DemandID:
-			UpdateCs3Demand();
-			break;
-		case kIRDemandID:
-			UpdateIRDemand();
-			break;
-		case kIDDemandID:
-			UpdateIDDemand();
-			break;
-		case kIMDemandID:
-			UpdateIMDemand();
-			break;
-		case kIHTDemandID:
-			UpdateIHTDemand();
-			break;
+			const std::filesystem::path path = GetDemandHistoryFilePath();
+
+			// A new city does not have a save file or history yet.
+			if (!path.empty() && demandHistory.Load(path, pCity->GetCitySerialNumber(), pSimulator->GetSimDateNumber()))
+			{
+				Logger::GetInstance().WriteLine(
+					LogLevel::Info,
+					"Loaded {} months of demand history.",
+					demandHistory.GetSampleCount());
+			}
 		}
 	}
 
-	void UpdateDemandValues()
+	void SaveDemandHistory()
 	{
-		UpdateCs1Demand();
-		UpdateCs2Demand();
-		UpdateCs3Demand();
-		UpdateIRDemand();
-		UpdateIDDemand();
-		UpdateIMDemand();
-		UpdateIHTDemand();
+		if (kPersistDemandHistory && pCity && demandHistory.GetSampleCount() > 0)
+		{
+			const std::filesystem::path path = GetDemandHistoryFilePath();
+
+			if (path.empty() || !demandHistory.Save(path, pCity->GetCitySerialNumber()))
+			{
+				Logger::GetInstance().WriteLine(LogLevel::Error, "Failed to save the demand history.");
+			}
+		}
 	}
 
-	void UpdateRCIGroupPopulationValues()
+	void RecordDemandHistorySample()
 	{
-		if (pAdvisorSystem)
+		if (kPersistDemandHistory && pSimulator)
 		{
-			// The game already includes regional totals for the residential, commercial and industrial
-			// groups, we add regional totals for the 12 RCI subgroups.
-			//
-			// The game's overall RCI population values may come from a different source than our totals for
-			// the individual groups, but that should be fine as the overall total rarely if ever equals the
-			// sum of the individual group totals.
+			DemandHistorySample sample{};
+			sample.simDate = pSimulator->GetSimDateNumber();
+
+			const DemandSnapshotData& snapshot = demandSnapshot.GetCurrent();
+
+			for (size_t i = 0; i < DemandVariables::Count; i++)
+			{
+				sample.demand[i] = snapshot.groups[i].demand;
+				sample.activeDemand[i] = snapshot.groups[i].activeDemand;
+			}
+
+			sample.taxIncome = taxIncome;
 
 			const PopulationTotals& totals = regionalCityDataProvider.GetRegionTotalPopulation();
 
-			pAdvisorSystem->SetGlobalValue("g_region_r1_population", static_cast<double>(totals.res1Pop));
-			pAdvisorSystem->SetGlobalValue("g_region_r2_population", static_cast<double>(totals.res2Pop));
-			pAdvisorSystem->SetGlobalValue("g_region_r3_population", static_cast<double>(totals.res3Pop));
-			pAdvisorSystem->SetGlobalValue("g_region_cs1_population", static_cast<double>(totals.cs1Pop));
-			pAdvisorSystem->SetGlobalValue("g_region_cs2_population", static_cast<double>(totals.cs2Pop));
-			pAdvisorSystem->SetGlobalValue("g_region_cs3_population", static_cast<double>(totals.cs3Pop));
-			pAdvisorSystem->SetGlobalValue("g_region_co2_population", static_cast<double>(totals.co2Pop));
-			pAdvisorSystem->SetGlobalValue("g_region_co3_population", static_cast<double>(totals.co3Pop));
-			pAdvisorSystem->SetGlobalValue("g_region_ir_population", static_cast<double>(totals.irPop));
-			pAdvisorSystem->SetGlobalValue("g_region_id_population", static_cast<double>(totals.idPop));
-			pAdvisorSystem->SetGlobalValue("g_region_im_population", static_cast<double>(totals.imPop));
-			pAdvisorSystem->SetGlobalValue("g_region_iht_population", static_cast<double>(totals.ihtPop));
+			for (size_t i = 0; i < RegionPopulationVariables.size(); i++)
+			{
+				sample.regionPopulation[i] = totals.*RegionPopulationVariables[i].first;
+			}
+
+			demandHistory.AddSample(sample);
 		}
 	}
 
-	void UpdateRCIGroupTaxIncome()
+	template <size_t Slot>
+	void UpdateDemandForecastVariables()
 	{
-		if (pAdvisorSystem && pBudgetSim)
+		using DemandVariables::DemandForecastMonths;
+		using DemandVariables::DemandForecastValue;
+		using DemandVariables::DemandForecastVariableName;
+
+		const float forecast = demandForecast.GetForecast(Slot, DemandForecastMonths);
+		const float interval = kDemandForecastIntervalScale * demandForecast.GetForecastDeviation(Slot, DemandForecastMonths);
+
+		std::array<GlobalValueShadow, DemandForecastValueCount>& shadows = demandForecastShadows[Slot];
+
+		globalValueWriter.SetGlobalValue(
+			shadows[static_cast<size_t>(DemandForecastValue::Forecast)],
+			DemandForecastVariableName<Slot, DemandForecastValue::Forecast>.data(),
+			forecast);
+		globalValueWriter.SetGlobalValue(
+			shadows[static_cast<size_t>(DemandForecastValue::Low)],
+			DemandForecastVariableName<Slot, DemandForecastValue::Low>.data(),
+			forecast - interval);
+		globalValueWriter.SetGlobalValue(
+			shadows[static_cast<size_t>(DemandForecastValue::High)],
+			DemandForecastVariableName<Slot, DemandForecastValue::High>.data(),
+			forecast + interval);
+	}
+
+	template <size_t... Slots>
+	void UpdateDemandForecastValues(std::index_sequence<Slots...>)
+	{
+		(UpdateDemandForecastVariables<Slots>(), ...);
+	}
+
+	void UpdateDemandForecastValues()
+	{
+		if (kPublishDemandForecast && pAdvisorSystem && demandForecast.HasForecast())
 		{
-			for (const auto& item : RCIGroupTaxIncomeVariables)
+			UpdateDemandForecastValues(std::make_index_sequence<DemandVariables::Count>());
+		}
+	}
+
+	void UpdateDemandForecast()
+	{
+		if (kPublishDemandForecast)
+		{
+			const DemandSnapshotData& snapshot = demandSnapshot.GetCurrent();
+
+			std::array<float, DemandVariables::Count> values{};
+
+			for (size_t i = 0; i < DemandVariables::Count; i++)
 			{
-				const int64_t taxIncome = pBudgetSim->GetTaxIncome(item.first);
+				values[i] = snapshot.groups[i].demand;
+			}
 
-				pAdvisorSystem->SetGlobalValue(item.second, static_cast<double>(taxIncome));
+			demandForecast.Update(values);
+		}
+	}
+
+	void RebuildDemandForecast()
+	{
+		// The model is rebuilt from the stored history when a city is loaded, this
+		// is a one-time cost and avoids storing the model state separately.
+		demandForecast.Reset();
+
+		if (kPublishDemandForecast)
+		{
+			for (size_t i = 0; i < demandHistory.GetSampleCount(); i++)
+			{
+				demandForecast.Update(demandHistory.GetSample(i).demand);
+			}
+		}
+	}
+
+	void UpdateDemandHistoryValues()
+	{
+		if (kPersistDemandHistory && pAdvisorSystem && demandHistory.GetSampleCount() > 0)
+		{
+			for (size_t i = 0; i < RCIGroupTaxIncomeAverageVariables.size(); i++)
+			{
+				const double average = demandHistory.GetAverage(
+					&DemandHistorySample::taxIncome,
+					i,
+					kDemandHistoryAverageMonths);
+
+				moreDemandInfoService.SetTaxIncomeAverage(i, average);
+				globalValueWriter.SetGlobalValue(taxIncomeAverageShadows[i], RCIGroupTaxIncomeAverageVariables[i], average);
 			}
 		}
 	}
 
 	void PostCityInit(cIGZMessage2Standard* pStandardMsg)
 	{
-		cISC4City* pCity = static_cast<cISC4City*>(pStandardMsg->GetVoid1());
+		pCity = static_cast<cISC4City*>(pStandardMsg->GetVoid1());
 
 		if (pCity)
 		{
 			pAdvisorSystem = pCity->GetAdvisorSystem();
 			pBudgetSim = pCity->GetBudgetSimulator();
 			pDemandSim = pCity->GetDemandSimulator();
+			pSimulator = pCity->GetSimulator();
+			pPollutionSim = pCity->GetPollutionSimulator();
+			pPoliceSim = pCity->GetPoliceSimulator();
+
+			demandSnapshot.Attach(pDemandSim);
+
+			globalValueWriter.SetAdvisorSystem(pAdvisorSystem);
+
+			if (kCoalesceActiveDemandChanges)
+			{
+				if (!simulatorTickAgent.Register(pSimulator))
+				{
+					Logger::GetInstance().WriteLine(
+						LogLevel::Error,
+						"Failed to register the simulator agent, the demand variables will be updated for every message.");
+				}
+			}
+
+			moreDemandInfoService.SetCityLoaded(true);
+
+			if (pSimulator)
+			{
+				moreDemandInfoService.SetSimDate(pSimulator->GetSimDateNumber());
+			}
+
+			cISC4LotManager* pLotManager = pCity->GetLotManager();
+
+			buildingCensus.Initialize(pLotManager, pCity->GetOccupantManager());
+
+			// The lot count includes the lots that do not have a building. A building count
+			// that is far below the lot count means the census scan missed part of the city.
+			Logger::GetInstance().WriteLine(
+				LogLevel::Info,
+				"The building census found {} buildings, the city has {} lots.",
+				buildingCensus.GetBuildingCount(),
+				pLotManager ? pLotManager->GetLotCount() : 0);
 
 			regionalCityDataProvider.PostCityInit();
 			UpdateDemandValues();
+			UpdateBuildingCensusValues();
+			UpdateGridSummaryValues();
 			UpdateRCIGroupPopulationValues();
 			UpdateRCIGroupTaxIncome();
+			LoadDemandHistory();
+			UpdateDemandHistoryValues();
+			RebuildDemandForecast();
+			UpdateDemandForecastValues();
 		}
 	}
 
 	void PostSave()
 	{
+		SaveDemandHistory();
 		regionalCityDataProvider.PostSave();
 		UpdateRCIGroupPopulationValues();
 	}
 
 	void PreCityShutdown()
 	{
+		LOG_WRITE_LINE(
+			LogLevel::Debug,
+			"Lua global variable writes: {} emitted, {} suppressed.",
+			globalValueWriter.GetEmittedWriteCount(),
+			globalValueWriter.GetSuppressedWriteCount());
+
+		INSTRUMENT_WRITE_TO_LOG();
+		INSTRUMENT_RESET();
+
+		globalValueWriter.SetAdvisorSystem(nullptr);
+		globalValueWriter.ResetCounters();
+		simulatorTickAgent.Unregister();
+		dirtyDemandSlots = 0;
+		buildingCensusChanged = false;
+		taxIncome.fill(0);
+		demandSnapshot.Detach();
+		demandHistory.Clear();
+		demandForecast.Reset();
+		simulatorTickCount = 0;
+		activeDemandChangesSinceTick = 0;
+
+		for (ActiveDemandStatistics& statistics : activeDemandStatistics)
+		{
+			statistics.Reset();
+		}
+		buildingCensus.Shutdown();
+		moreDemandInfoService.Reset();
 		pAdvisorSystem = nullptr;
 		pBudgetSim = nullptr;
 		pDemandSim = nullptr;
+		pSimulator = nullptr;
+		pPollutionSim = nullptr;
+		pPoliceSim = nullptr;
+		pCity = nullptr;
 	}
 
 	void SimNewMonth()
 	{
 		UpdateRCIGroupTaxIncome();
+
+		if (pSimulator)
+		{
+			moreDemandInfoService.SetSimDate(pSimulator->GetSimDateNumber());
+		}
+
+		// The monthly features read the demand values from one capture.
+		demandSnapshot.CaptureAll();
+
+		RecordDemandHistorySample();
+		UpdateDemandHistoryValues();
+		UpdateDemandForecast();
+		UpdateDemandForecastValues();
+		UpdateGridSummaryValues();
+
+		if (kPublishInstrumentationStats)
+		{
+			INSTRUMENT_PUBLISH_GLOBAL_VALUES(globalValueWriter);
+		}
 	}
 
 	bool DoMessage(cIGZMessage2* pMessage)
@@ -474,6 +1127,9 @@ public:
 		cIGZMessage2Standard* pStandardMsg = static_cast<cIGZMessage2Standard*>(pMessage);
 		uint32_t dwType = pMessage->GetType();
 
+		INSTRUMENT_MESSAGE(dwType);
+		INSTRUMENT_SCOPE(InstrumentedCallSite::DoMessage);
+
 		switch (dwType)
 		{
 		case kSC4MessageActiveDemandChanged:
@@ -491,8 +1147,16 @@ public:
 		case kSC4MessageSimNewMonth:
 			SimNewMonth();
 			break;
+		case kSC4MessageInsertOccupant:
+			OccupantInserted(pStandardMsg);
+			break;
+		case kSC4MessageRemoveOccupant:
+			OccupantRemoved(pStandardMsg);
+			break;
 		}
 
+		PublishMoreDemandInfo();
+
 		return true;
 	}
 
@@ -518,6 +1182,24 @@ public:
 			return false;
 		}
 
+		if (kExportSharedMemory)
+		{
+			if (!sharedMemoryExport.Open())
+			{
+				logger.WriteLine(LogLevel::Error, "Failed to create the shared memory export.");
+			}
+		}
+
+		return true;
+	}
+
+	bool PostAppShutdown()
+	{
+		sharedMemoryExport.Close();
+
+		// Write any queued log lines before the game exits.
+		Logger::GetInstance().Shutdown();
+
 		return true;
 	}
 
@@ -548,17 +1230,51 @@ private:
 		return temp.parent_path();
 	}
 
+	cISC4City* pCity;
 	cISC4AdvisorSystem* pAdvisorSystem;
 	cISC4BudgetSimulator* pBudgetSim;
 	cISC4DemandSimulator* pDemandSim;
+	cISC4Simulator* pSimulator;
+	cISC4PollutionSimulator* pPollutionSim;
+	cISC4PoliceSimulator* pPoliceSim;
 	RegionalCityDataProvider regionalCityDataProvider;
-	bool firstCs1DemandUpdate;
-	bool firstCs2DemandUpdate;
-	bool firstCs3DemandUpdate;
-	bool firstIRDemandUpdate;
-	bool firstIDDemandUpdate;
-	bool firstIMDemandUpdate;
-	bool firstIHTDemandUpdate;
+	DemandSnapshot demandSnapshot;
+	BuildingCensus buildingCensus;
+	std::array<std::array<GlobalValueShadow, 4>, DemandVariables::Count> buildingCensusShadows;
+	GridSummarizer gridSummarizer;
+	std::array<std::array<std::string, kGridSummaryValueCount>, SummarizedGridCount> gridSummaryVariableNames;
+	std::array<std::array<GlobalValueShadow, kGridSummaryValueCount>, SummarizedGridCount> gridSummaryShadows;
+	GlobalValueWriter globalValueWriter;
+	std::array<DemandVariableShadows, DemandVariables::Count> demandShadows;
+	std::array<GlobalValueShadow, RegionPopulationVariables.size()> regionPopulationShadows;
+	std::array<GlobalStringShadow, RegionPopulationTextVariables.size()> regionPopulationTextShadows;
+	std::array<GlobalValueShadow, NearbyPopulationVariables.size()> nearbyPopulationShadows;
+	std::array<std::array<GlobalValueShadow, 4>, RegionEconomyMetricCount> regionEconomyShadows;
+	// The tax income values that were read by the last UpdateRCIGroupTaxIncome call.
+	std::array<int64_t, RCIGroupTaxIncomeVariables.size()> taxIncome;
+	std::array<GlobalValueShadow, RCIGroupTaxIncomeVariables.size()> taxIncomeShadows;
+	std::array<GlobalStringShadow, RCIGroupTaxIncomeTextVariables.size()> taxIncomeTextShadows;
+	std::array<GlobalValueShadow, RCIGroupTaxIncomeAverageVariables.size()> taxIncomeAverageShadows;
+	DemandHistory demandHistory;
+	static constexpr size_t DemandForecastValueCount = static_cast<size_t>(DemandVariables::DemandForecastValue::Count);
+	DemandForecast demandForecast;
+	std::array<std::array<GlobalValueShadow, DemandForecastValueCount>, DemandVariables::Count> demandForecastShadows;
+	SimulatorTickAgent simulatorTickAgent;
+	// A bit set of the DemandVariables table slots that changed since the last simulator tick.
+	uint32_t dirtyDemandSlots;
+	// True if the building census changed since the last simulator tick.
+	bool buildingCensusChanged;
+	std::array<bool, DemandVariables::Count> firstDemandUpdate;
+	uint64_t simulatorTickCount;
+	// The number of ActiveDemandChanged messages since the last simulator tick.
+	uint32_t activeDemandChangesSinceTick;
+	static constexpr size_t ActiveDemandStatisticCount = static_cast<size_t>(DemandVariables::ActiveDemandStatistic::Count);
+	std::array<ActiveDemandStatistics, DemandVariables::Count> activeDemandStatistics;
+	std::array<std::array<GlobalValueShadow, ActiveDemandStatisticCount>, DemandVariables::Count> activeDemandStatisticShadows;
+	MoreDemandInfoService moreDemandInfoService;
+	SharedMemoryExport sharedMemoryExport;
+
+	static_assert(DemandVariables::Count <= 32, "The dirty demand slots do not fit in a uint32_t.");
 };
 
 cRZCOMDllDirector* RZGetCOMDllDirector() {
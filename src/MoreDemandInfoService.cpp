@@ -0,0 +1,164 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "MoreDemandInfoService.h"
+#include "DemandVariables.h"
+#include <cassert>
+#include <cstring>
+#include <iterator>
+
+static_assert(sizeof(PopulationTotals) == sizeof(cISC4MoreDemandInfoData::regionPopulation));
+static_assert(sizeof(PopulationTotals) == sizeof(cISC4MoreDemandInfoData::nearbyPopulation));
+// The demand groups are indexed by DemandVariables table slot, and validDemandGroups has one bit per slot.
+static_assert(std::size(cISC4MoreDemandInfoData{}.demandGroups) == DemandVariables::Count);
+static_assert(DemandVariables::Count <= 32, "The valid demand groups do not fit in a uint32_t.");
+
+namespace
+{
+	template <typename T>
+	void SetValue(T& field, T value, bool& changed)
+	{
+		if (field != value)
+		{
+			field = value;
+			changed = true;
+		}
+	}
+
+	void SetPopulation(int64_t (&field)[12], const PopulationTotals& totals, bool& changed)
+	{
+		if (std::memcmp(field, &totals, sizeof(field)) != 0)
+		{
+			std::memcpy(field, &totals, sizeof(field));
+			changed = true;
+		}
+	}
+}
+
+MoreDemandInfoService::MoreDemandInfoService()
+	: data{},
+	  generation(0),
+	  refCount(0),
+	  changed(false)
+{
+	data.size = sizeof(data);
+}
+
+bool MoreDemandInfoService::QueryInterface(uint32_t riid, void** ppvObj)
+{
+	if (riid == GZIID_cISC4MoreDemandInfo)
+	{
+		*ppvObj = static_cast<cISC4MoreDemandInfo*>(this);
+		AddRef();
+
+		return true;
+	}
+	else if (riid == GZIID_cIGZUnknown)
+	{
+		*ppvObj = static_cast<cIGZUnknown*>(this);
+		AddRef();
+
+		return true;
+	}
+
+	return false;
+}
+
+uint32_t MoreDemandInfoService::AddRef()
+{
+	return ++refCount;
+}
+
+uint32_t MoreDemandInfoService::Release()
+{
+	// The object is owned by the DLL director, so it is not deleted
+	// when the reference count reaches zero.
+	if (refCount > 0)
+	{
+		--refCount;
+	}
+
+	return refCount;
+}
+
+uint32_t MoreDemandInfoService::GetGeneration() const
+{
+	return generation;
+}
+
+const cISC4MoreDemandInfoData* MoreDemandInfoService::GetData() const
+{
+	return &data;
+}
+
+void MoreDemandInfoService::SetCityLoaded(bool loaded)
+{
+	SetValue(data.cityLoaded, loaded ? 1U : 0U, changed);
+}
+
+void MoreDemandInfoService::SetSimDate(int32_t simDate)
+{
+	SetValue(data.simDate, simDate, changed);
+}
+
+void MoreDemandInfoService::SetDemandGroup(size_t index, uint32_t demandID, float activeDemand, float demand, float demandCap)
+{
+	assert(index < std::size(data.demandGroups));
+
+	cISC4MoreDemandInfoDemandGroup& group = data.demandGroups[index];
+
+	SetValue(group.demandID, demandID, changed);
+	SetValue(group.activeDemand, activeDemand, changed);
+	SetValue(group.demand, demand, changed);
+	SetValue(group.demandCap, demandCap, changed);
+	SetValue(data.validDemandGroups, data.validDemandGroups | (1U << index), changed);
+}
+
+void MoreDemandInfoService::SetTaxIncome(size_t index, int64_t taxIncome)
+{
+	assert(index < std::size(data.taxIncome));
+
+	SetValue(data.taxIncome[index], taxIncome, changed);
+}
+
+void MoreDemandInfoService::SetTaxIncomeAverage(size_t index, double average)
+{
+	assert(index < std::size(data.taxIncomeAverage));
+
+	SetValue(data.taxIncomeAverage[index], average, changed);
+}
+
+void MoreDemandInfoService::SetRegionPopulation(const PopulationTotals& totals)
+{
+	SetPopulation(data.regionPopulation, totals, changed);
+}
+
+void MoreDemandInfoService::SetNearbyPopulation(const PopulationTotals& totals)
+{
+	SetPopulation(data.nearbyPopulation, totals, changed);
+}
+
+void MoreDemandInfoService::Reset()
+{
+	data = {};
+	data.size = sizeof(data);
+	changed = true;
+}
+
+void MoreDemandInfoService::CommitChanges()
+{
+	if (changed)
+	{
+		changed = false;
+		++generation;
+	}
+}
@@ -0,0 +1,69 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "cISC4MoreDemandInfo.h"
+#include "PopulationTotals.h"
+#include <cstddef>
+
+/**
+ * @brief The cISC4MoreDemandInfo implementation, it stores a copy of the values
+ * that the plugin writes to the Lua game table.
+ *
+ * The setters only mark the data as changed, the generation is advanced once by
+ * CommitChanges after the plugin finishes updating its values.
+ */
+class MoreDemandInfoService final : public cISC4MoreDemandInfo
+{
+public:
+	MoreDemandInfoService();
+
+	bool QueryInterface(uint32_t riid, void** ppvObj) override;
+
+	uint32_t AddRef() override;
+
+	uint32_t Release() override;
+
+	uint32_t GetGeneration() const override;
+
+	const cISC4MoreDemandInfoData* GetData() const override;
+
+	void SetCityLoaded(bool loaded);
+
+	void SetSimDate(int32_t simDate);
+
+	void SetDemandGroup(size_t index, uint32_t demandID, float activeDemand, float demand, float demandCap);
+
+	void SetTaxIncome(size_t index, int64_t taxIncome);
+
+	void SetTaxIncomeAverage(size_t index, double average);
+
+	void SetRegionPopulation(const PopulationTotals& totals);
+
+	void SetNearbyPopulation(const PopulationTotals& totals);
+
+	/**
+	 * @brief Clears the values when the city is shut down.
+	 */
+	void Reset();
+
+	/**
+	 * @brief Advances the generation if any of the values changed.
+	 */
+	void CommitChanges();
+
+private:
+	cISC4MoreDemandInfoData data;
+	uint32_t generation;
+	uint32_t refCount;
+	bool changed;
+};
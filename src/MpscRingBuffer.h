@@ -0,0 +1,135 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+/**
+ * @brief A bounded lock-free queue with multiple producers and a single consumer.
+ *
+ * This is Dmitry Vyukov's bounded queue, each cell has a sequence number that tells
+ * the producers and the consumer whether the cell is free or holds a value.
+ *
+ * @tparam T The item type, it must be trivially copyable.
+ * @tparam Capacity The number of items in the queue, it must be a power of 2.
+ */
+template <typename T, size_t Capacity>
+class MpscRingBuffer
+{
+	static_assert(std::has_single_bit(Capacity), "The capacity must be a power of 2.");
+	static_assert(std::is_trivially_copyable_v<T>, "The item type must be trivially copyable.");
+
+public:
+	MpscRingBuffer()
+		: cells(std::make_unique<Cell[]>(Capacity)),
+		  enqueuePosition(0),
+		  dequeuePosition(0)
+	{
+		for (size_t i = 0; i < Capacity; i++)
+		{
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	MpscRingBuffer(const MpscRingBuffer&) = delete;
+	MpscRingBuffer& operator=(const MpscRingBuffer&) = delete;
+
+	/**
+	 * @brief Adds an item to the queue.
+	 * @param fill A function that writes the item in place, it is called with a T&.
+	 * @return True if the item was added; otherwise, false if the queue is full.
+	 */
+	template <typename TFill>
+	bool TryPush(TFill&& fill)
+	{
+		size_t position = enqueuePosition.load(std::memory_order_relaxed);
+
+		while (true)
+		{
+			Cell& cell = cells[position & Mask];
+			const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+			const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+			if (difference == 0)
+			{
+				if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				{
+					fill(cell.item);
+
+					// Publish the item to the consumer.
+					cell.sequence.store(position + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (difference < 0)
+			{
+				return false;
+			}
+			else
+			{
+				position = enqueuePosition.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	/**
+	 * @brief Removes the next item from the queue. This must only be called by the consumer.
+	 * @param item The removed item.
+	 * @return True if an item was removed; otherwise, false if the queue is empty.
+	 */
+	bool TryPop(T& item)
+	{
+		const size_t position = dequeuePosition.load(std::memory_order_relaxed);
+
+		Cell& cell = cells[position & Mask];
+		const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+
+		if (sequence != position + 1)
+		{
+			return false;
+		}
+
+		item = cell.item;
+
+		dequeuePosition.store(position + 1, std::memory_order_relaxed);
+		cell.sequence.store(position + Capacity, std::memory_order_release);
+
+		return true;
+	}
+
+	bool IsEmpty() const
+	{
+		const size_t position = dequeuePosition.load(std::memory_order_relaxed);
+
+		return cells[position & Mask].sequence.load(std::memory_order_acquire) != position + 1;
+	}
+
+private:
+	static constexpr size_t Mask = Capacity - 1;
+
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		T item;
+	};
+
+	std::unique_ptr<Cell[]> cells;
+	// The producer and consumer positions are kept on separate cache lines.
+	alignas(64) std::atomic<size_t> enqueuePosition;
+	alignas(64) std::atomic<size_t> dequeuePosition;
+};
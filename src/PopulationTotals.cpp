@@ -0,0 +1,61 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "PopulationTotals.h"
+
+PopulationTotals& PopulationTotals::operator+=(const PopulationTotals& other)
+{
+	res1Pop += other.res1Pop;
+	res2Pop += other.res2Pop;
+	res3Pop += other.res3Pop;
+	cs1Pop += other.cs1Pop;
+	cs2Pop += other.cs2Pop;
+	cs3Pop += other.cs3Pop;
+	co2Pop += other.co2Pop;
+	co3Pop += other.co3Pop;
+	irPop += other.irPop;
+	idPop += other.idPop;
+	imPop += other.imPop;
+	ihtPop += other.ihtPop;
+
+	return *this;
+}
+
+PopulationTotals& PopulationTotals::operator-=(const PopulationTotals& other)
+{
+	res1Pop -= other.res1Pop;
+	res2Pop -= other.res2Pop;
+	res3Pop -= other.res3Pop;
+	cs1Pop -= other.cs1Pop;
+	cs2Pop -= other.cs2Pop;
+	cs3Pop -= other.cs3Pop;
+	co2Pop -= other.co2Pop;
+	co3Pop -= other.co3Pop;
+	irPop -= other.irPop;
+	idPop -= other.idPop;
+	imPop -= other.imPop;
+	ihtPop -= other.ihtPop;
+
+	return *this;
+}
+
+PopulationTotals operator+(PopulationTotals lhs, const PopulationTotals& rhs)
+{
+	lhs += rhs;
+	return lhs;
+}
+
+PopulationTotals operator-(PopulationTotals lhs, const PopulationTotals& rhs)
+{
+	lhs -= rhs;
+	return lhs;
+}
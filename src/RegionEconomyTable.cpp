@@ -0,0 +1,140 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "RegionEconomyTable.h"
+#include <algorithm>
+
+namespace
+{
+	// The column is reduced with four independent accumulators, this removes the
+	// dependency between the loop iterations so that the compiler can vectorize it.
+	constexpr size_t kLaneCount = 4;
+
+	RegionEconomyStatistics ReduceColumn(const float* values, size_t count)
+	{
+		RegionEconomyStatistics statistics{};
+
+		if (count == 0)
+		{
+			return statistics;
+		}
+
+		std::array<double, kLaneCount> sums{};
+		std::array<float, kLaneCount> mins;
+		std::array<float, kLaneCount> maxes;
+
+		mins.fill(values[0]);
+		maxes.fill(values[0]);
+
+		const size_t vectorCount = count - (count % kLaneCount);
+
+		for (size_t i = 0; i < vectorCount; i += kLaneCount)
+		{
+			for (size_t lane = 0; lane < kLaneCount; lane++)
+			{
+				const float value = values[i + lane];
+
+				sums[lane] += value;
+				mins[lane] = value < mins[lane] ? value : mins[lane];
+				maxes[lane] = value > maxes[lane] ? value : maxes[lane];
+			}
+		}
+
+		for (size_t i = vectorCount; i < count; i++)
+		{
+			const float value = values[i];
+
+			sums[0] += value;
+			mins[0] = value < mins[0] ? value : mins[0];
+			maxes[0] = value > maxes[0] ? value : maxes[0];
+		}
+
+		statistics.total = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+		statistics.mean = statistics.total / static_cast<double>(count);
+		statistics.min = *std::min_element(mins.begin(), mins.end());
+		statistics.max = *std::max_element(maxes.begin(), maxes.end());
+
+		return statistics;
+	}
+}
+
+void RegionEconomySummary::AddCity(const RegionalCityEconomy& economy)
+{
+	for (size_t i = 0; i < RegionEconomyMetricCount; i++)
+	{
+		RegionEconomyStatistics& statistics = metrics[i];
+		const float value = economy.values[i];
+
+		if (cityCount == 0)
+		{
+			statistics.min = value;
+			statistics.max = value;
+		}
+		else
+		{
+			statistics.min = std::min(statistics.min, value);
+			statistics.max = std::max(statistics.max, value);
+		}
+
+		statistics.total += value;
+		statistics.mean = statistics.total / static_cast<double>(cityCount + 1);
+	}
+
+	cityCount++;
+}
+
+RegionEconomyTable::RegionEconomyTable()
+	: columns()
+{
+}
+
+void RegionEconomyTable::Clear()
+{
+	for (std::vector<float>& column : columns)
+	{
+		column.clear();
+	}
+}
+
+void RegionEconomyTable::Reserve(size_t cityCount)
+{
+	for (std::vector<float>& column : columns)
+	{
+		column.reserve(cityCount);
+	}
+}
+
+void RegionEconomyTable::AddCity(const RegionalCityEconomy& economy)
+{
+	for (size_t i = 0; i < RegionEconomyMetricCount; i++)
+	{
+		columns[i].push_back(economy.values[i]);
+	}
+}
+
+size_t RegionEconomyTable::GetCityCount() const
+{
+	return columns[0].size();
+}
+
+RegionEconomySummary RegionEconomyTable::Summarize() const
+{
+	RegionEconomySummary summary{};
+	summary.cityCount = static_cast<uint32_t>(GetCityCount());
+
+	for (size_t i = 0; i < RegionEconomyMetricCount; i++)
+	{
+		summary.metrics[i] = ReduceColumn(columns[i].data(), columns[i].size());
+	}
+
+	return summary;
+}
@@ -0,0 +1,91 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class RegionEconomyMetric : size_t
+{
+	// cISC4RegionalCity::GetBudget
+	Budget = 0,
+	// cISC4RegionalCity::GetIncome
+	Income,
+	// cISC4RegionalCity::GetPopulation
+	Population,
+	// cISC4RegionalCity::GetCommercialJobs
+	CommercialJobs,
+	// cISC4RegionalCity::GetIndustrialJobs
+	IndustrialJobs,
+	// cISC4RegionalCity::GetWorkforcePercentage, in the range of [0, 1].
+	WorkforcePercentage,
+	Count
+};
+
+inline constexpr size_t RegionEconomyMetricCount = static_cast<size_t>(RegionEconomyMetric::Count);
+
+/**
+ * @brief The economy values of a regional city.
+ */
+struct RegionalCityEconomy
+{
+	std::array<float, RegionEconomyMetricCount> values;
+
+	bool operator==(const RegionalCityEconomy& other) const = default;
+};
+
+struct RegionEconomyStatistics
+{
+	double total;
+	double mean;
+	float min;
+	float max;
+};
+
+struct RegionEconomySummary
+{
+	uint32_t cityCount;
+	std::array<RegionEconomyStatistics, RegionEconomyMetricCount> metrics;
+
+	/**
+	 * @brief Adds a city that is not part of the table to the summary.
+	 */
+	void AddCity(const RegionalCityEconomy& economy);
+};
+
+/**
+ * @brief The economy values of the established regional cities, stored with one
+ * column per metric and one row per city.
+ */
+class RegionEconomyTable
+{
+public:
+	RegionEconomyTable();
+
+	void Clear();
+
+	void Reserve(size_t cityCount);
+
+	void AddCity(const RegionalCityEconomy& economy);
+
+	size_t GetCityCount() const;
+
+	/**
+	 * @brief Computes the total, mean, minimum and maximum of each metric.
+	 */
+	RegionEconomySummary Summarize() const;
+
+private:
+	std::array<std::vector<float>, RegionEconomyMetricCount> columns;
+};
@@ -0,0 +1,150 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "RegionSpatialIndex.h"
+#include <algorithm>
+
+namespace
+{
+	constexpr std::array<uint32_t, 3> kCitySizes = { 1, 2, 4 };
+
+	void CreateSortedPositions(std::vector<int64_t>& positions)
+	{
+		std::sort(positions.begin(), positions.end());
+		positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+	}
+
+	size_t GetPositionIndex(const std::vector<int64_t>& positions, int64_t value)
+	{
+		return static_cast<size_t>(std::lower_bound(positions.begin(), positions.end(), value) - positions.begin());
+	}
+}
+
+RegionSpatialIndex::RegionSpatialIndex()
+	: sizeClasses()
+{
+	Clear();
+}
+
+void RegionSpatialIndex::Build(const std::vector<City>& cities)
+{
+	Clear();
+
+	for (SizeClass& sizeClass : sizeClasses)
+	{
+		for (const City& city : cities)
+		{
+			if (city.footprint.size == sizeClass.size)
+			{
+				sizeClass.xs.push_back(city.footprint.x);
+				sizeClass.zs.push_back(city.footprint.z);
+			}
+		}
+
+		if (sizeClass.xs.empty())
+		{
+			continue;
+		}
+
+		CreateSortedPositions(sizeClass.xs);
+		CreateSortedPositions(sizeClass.zs);
+
+		const size_t width = sizeClass.xs.size() + 1;
+		const size_t height = sizeClass.zs.size() + 1;
+
+		sizeClass.prefixSums.assign(width * height, PopulationTotals{});
+
+		// Add each city to the entry after its position, then accumulate the entries.
+		for (const City& city : cities)
+		{
+			if (city.footprint.size == sizeClass.size)
+			{
+				const size_t i = GetPositionIndex(sizeClass.xs, city.footprint.x) + 1;
+				const size_t j = GetPositionIndex(sizeClass.zs, city.footprint.z) + 1;
+
+				sizeClass.prefixSums[(j * width) + i] += city.totals;
+			}
+		}
+
+		for (size_t j = 1; j < height; j++)
+		{
+			for (size_t i = 1; i < width; i++)
+			{
+				PopulationTotals& entry = sizeClass.prefixSums[(j * width) + i];
+
+				entry += sizeClass.prefixSums[(j * width) + i - 1];
+				entry += sizeClass.prefixSums[((j - 1) * width) + i];
+				entry -= sizeClass.prefixSums[((j - 1) * width) + i - 1];
+			}
+		}
+	}
+}
+
+void RegionSpatialIndex::Clear()
+{
+	for (size_t i = 0; i < sizeClasses.size(); i++)
+	{
+		SizeClass& sizeClass = sizeClasses[i];
+
+		sizeClass.size = kCitySizes[i];
+		sizeClass.xs.clear();
+		sizeClass.zs.clear();
+		sizeClass.prefixSums.clear();
+	}
+}
+
+PopulationTotals RegionSpatialIndex::Query(int64_t x0, int64_t z0, int64_t x1, int64_t z1) const
+{
+	PopulationTotals totals{};
+
+	for (const SizeClass& sizeClass : sizeClasses)
+	{
+		if (sizeClass.xs.empty())
+		{
+			continue;
+		}
+
+		// A city overlaps the rectangle when its position is in [x0 - size + 1, x1) and
+		// [z0 - size + 1, z1), so each size class is queried with an expanded rectangle.
+		const int64_t offset = static_cast<int64_t>(sizeClass.size) - 1;
+
+		const size_t i0 = GetPositionIndex(sizeClass.xs, x0 - offset);
+		const size_t i1 = GetPositionIndex(sizeClass.xs, x1);
+		const size_t j0 = GetPositionIndex(sizeClass.zs, z0 - offset);
+		const size_t j1 = GetPositionIndex(sizeClass.zs, z1);
+
+		if (i0 < i1 && j0 < j1)
+		{
+			totals += sizeClass.GetPrefixSum(i1, j1);
+			totals -= sizeClass.GetPrefixSum(i0, j1);
+			totals -= sizeClass.GetPrefixSum(i1, j0);
+			totals += sizeClass.GetPrefixSum(i0, j0);
+		}
+	}
+
+	return totals;
+}
+
+PopulationTotals RegionSpatialIndex::QueryNearby(const RegionCityFootprint& footprint, uint32_t distance) const
+{
+	const int64_t x0 = static_cast<int64_t>(footprint.x) - distance;
+	const int64_t z0 = static_cast<int64_t>(footprint.z) - distance;
+	const int64_t x1 = static_cast<int64_t>(footprint.x) + footprint.size + distance;
+	const int64_t z1 = static_cast<int64_t>(footprint.z) + footprint.size + distance;
+
+	return Query(x0, z0, x1, z1);
+}
+
+const PopulationTotals& RegionSpatialIndex::SizeClass::GetPrefixSum(size_t i, size_t j) const
+{
+	return prefixSums[(j * (xs.size() + 1)) + i];
+}
@@ -0,0 +1,86 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "PopulationTotals.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief The area that a city occupies in the region, in small city tile units.
+ */
+struct RegionCityFootprint
+{
+	uint32_t x;
+	uint32_t z;
+	// The width and depth of the city: 1 for a small city, 2 for a medium city and 4 for a large city.
+	uint32_t size;
+};
+
+/**
+ * @brief An index of the regional city populations by their position in the region.
+ *
+ * The cities are grouped by their tile size, each group stores a summed-area table of the
+ * populations over the distinct city positions. A query performs a binary search for the
+ * bounds of the rectangle in each group and combines four table entries, so the cost of a
+ * query is logarithmic in the number of cities.
+ */
+class RegionSpatialIndex
+{
+public:
+	struct City
+	{
+		RegionCityFootprint footprint;
+		PopulationTotals totals;
+	};
+
+	RegionSpatialIndex();
+
+	void Build(const std::vector<City>& cities);
+
+	void Clear();
+
+	/**
+	 * @brief Gets the total population of the cities that overlap the specified rectangle.
+	 * @param x0 The left edge of the rectangle, inclusive.
+	 * @param z0 The top edge of the rectangle, inclusive.
+	 * @param x1 The right edge of the rectangle, exclusive.
+	 * @param z1 The bottom edge of the rectangle, exclusive.
+	 */
+	PopulationTotals Query(int64_t x0, int64_t z0, int64_t x1, int64_t z1) const;
+
+	/**
+	 * @brief Gets the total population of the cities that are within the specified
+	 * number of small city tiles of a city.
+	 * @param footprint The city footprint.
+	 * @param distance The distance in small city tiles, a distance of 1 includes the adjacent cities.
+	 */
+	PopulationTotals QueryNearby(const RegionCityFootprint& footprint, uint32_t distance) const;
+
+private:
+	struct SizeClass
+	{
+		uint32_t size;
+		// The distinct city positions, sorted in ascending order.
+		std::vector<int64_t> xs;
+		std::vector<int64_t> zs;
+		// The summed-area table, entry (i, j) holds the sum of the cities with an x position
+		// index less than i and a z position index less than j.
+		std::vector<PopulationTotals> prefixSums;
+
+		const PopulationTotals& GetPrefixSum(size_t i, size_t j) const;
+	};
+
+	std::array<SizeClass, 3> sizeClasses;
+};
@@ -11,16 +11,73 @@
 //////////////////////////////////////////////////////////////////////////
 
 #include "RegionalCityDataProvider.h"
+#include "Instrumentation.h"
 #include "cIGZMessage2Standard.h"
 #include "cISC4App.h"
 #include "cISC4Region.h"
 #include "cISC4RegionalCity.h"
 #include "GZServPtrs.h"
+#include "Logger.h"
+#include "SC4Percentage.h"
+
+namespace
+{
+	void ReadPopulationTotals(cISC4RegionalCity* pRegionalCity, PopulationTotals& totals)
+	{
+		totals.res1Pop = pRegionalCity->GetPopulation(0x1010);
+		totals.res2Pop = pRegionalCity->GetPopulation(0x1020);
+		totals.res3Pop = pRegionalCity->GetPopulation(0x1030);
+		totals.cs1Pop = pRegionalCity->GetPopulation(0x3110);
+		totals.cs2Pop = pRegionalCity->GetPopulation(0x3120);
+		totals.cs3Pop = pRegionalCity->GetPopulation(0x3130);
+		totals.co2Pop = pRegionalCity->GetPopulation(0x3320);
+		totals.co3Pop = pRegionalCity->GetPopulation(0x3330);
+		totals.irPop = pRegionalCity->GetPopulation(0x4100);
+		totals.idPop = pRegionalCity->GetPopulation(0x4200);
+		totals.imPop = pRegionalCity->GetPopulation(0x4300);
+		totals.ihtPop = pRegionalCity->GetPopulation(0x4400);
+	}
+
+	void ReadRegionalCityEconomy(cISC4RegionalCity* pRegionalCity, const RegionalCityKey& key, RegionalCityEconomy& economy)
+	{
+		const SC4Percentage* workforcePercentage = pRegionalCity->GetWorkforcePercentage();
+
+		economy.values[static_cast<size_t>(RegionEconomyMetric::Budget)] = pRegionalCity->GetBudget();
+		economy.values[static_cast<size_t>(RegionEconomyMetric::Income)] = pRegionalCity->GetIncome();
+		economy.values[static_cast<size_t>(RegionEconomyMetric::Population)] = static_cast<float>(key.population);
+		economy.values[static_cast<size_t>(RegionEconomyMetric::CommercialJobs)] = static_cast<float>(key.commercialJobs);
+		economy.values[static_cast<size_t>(RegionEconomyMetric::IndustrialJobs)] = static_cast<float>(key.industrialJobs);
+		economy.values[static_cast<size_t>(RegionEconomyMetric::WorkforcePercentage)] = workforcePercentage ? workforcePercentage->percentage : 0.0f;
+	}
+
+	uint64_t MakePositionKey(uint32_t x, uint32_t z)
+	{
+		return (static_cast<uint64_t>(x) << 32) | z;
+	}
+
+	uint32_t GetCitySize(cISC4Region::eCityTileSize cityTileSize)
+	{
+		switch (cityTileSize)
+		{
+		case cISC4Region::eCityTileSize::Medium:
+			return 2;
+		case cISC4Region::eCityTileSize::Large:
+			return 4;
+		case cISC4Region::eCityTileSize::Small:
+		default:
+			return 1;
+		}
+	}
+}
 
 RegionalCityDataProvider::RegionalCityDataProvider()
-	: regionPopulationTotals{},
+	: scanState{},
+	  regionDirectory(),
+	  regionPopulationTotals{},
 	  currentCityPopulationTotals{},
-	  regionalCityPopulationTotals{}
+	  regionEconomySummary{},
+	  currentCityEconomy{},
+	  currentCityEstablished(false)
 {
 }
 
@@ -29,33 +86,41 @@ const PopulationTotals& RegionalCityDataProvider::GetRegionTotalPopulation() con
 	return regionPopulationTotals;
 }
 
+PopulationTotals RegionalCityDataProvider::GetNearbyPopulation(uint32_t distance) const
+{
+	return scanState.spatialIndex.QueryNearby(scanState.currentCityFootprint, distance);
+}
+
+const RegionEconomySummary& RegionalCityDataProvider::GetRegionEconomySummary() const
+{
+	return regionEconomySummary;
+}
+
 void RegionalCityDataProvider::PostCityInit()
 {
-	UpdateRegionalCityPopulationTotals();
 	UpdateCurrentCityPopulationTotals();
-	UpdateRegionPopulationTotals();
+	UpdateCurrentCityEconomy();
+	UpdateRegionalCityPopulationTotals();
 }
 
 void RegionalCityDataProvider::PostSave()
 {
+	// Only the current city's row changes when the city is saved, so the region
+	// summary is updated without reading the other regional cities.
 	UpdateCurrentCityPopulationTotals();
+	UpdateCurrentCityEconomy();
 	UpdateRegionPopulationTotals();
 }
 
 void RegionalCityDataProvider::UpdateRegionPopulationTotals()
 {
-	regionPopulationTotals.res1Pop = currentCityPopulationTotals.res1Pop + regionalCityPopulationTotals.res1Pop;
-	regionPopulationTotals.res2Pop = currentCityPopulationTotals.res2Pop + regionalCityPopulationTotals.res2Pop;
-	regionPopulationTotals.res3Pop = currentCityPopulationTotals.res3Pop + regionalCityPopulationTotals.res3Pop;
-	regionPopulationTotals.cs1Pop = currentCityPopulationTotals.cs1Pop + regionalCityPopulationTotals.cs1Pop;
-	regionPopulationTotals.cs2Pop = currentCityPopulationTotals.cs2Pop + regionalCityPopulationTotals.cs2Pop;
-	regionPopulationTotals.cs3Pop = currentCityPopulationTotals.cs3Pop + regionalCityPopulationTotals.cs3Pop;
-	regionPopulationTotals.co2Pop = currentCityPopulationTotals.co2Pop + regionalCityPopulationTotals.co2Pop;
-	regionPopulationTotals.co3Pop = currentCityPopulationTotals.co3Pop + regionalCityPopulationTotals.co3Pop;
-	regionPopulationTotals.irPop = currentCityPopulationTotals.irPop + regionalCityPopulationTotals.irPop;
-	regionPopulationTotals.idPop = currentCityPopulationTotals.idPop + regionalCityPopulationTotals.idPop;
-	regionPopulationTotals.imPop = currentCityPopulationTotals.imPop + regionalCityPopulationTotals.imPop;
-	regionPopulationTotals.ihtPop = currentCityPopulationTotals.ihtPop + regionalCityPopulationTotals.ihtPop;
+	regionPopulationTotals = currentCityPopulationTotals + scanState.regionalTotals;
+	regionEconomySummary = scanState.economySummary;
+
+	if (currentCityEstablished)
+	{
+		regionEconomySummary.AddCity(currentCityEconomy);
+	}
 }
 
 void RegionalCityDataProvider::UpdateCurrentCityPopulationTotals()
@@ -68,82 +133,233 @@ void RegionalCityDataProvider::UpdateCurrentCityPopulationTotals()
 
 		if (pRegionalCity)
 		{
-			currentCityPopulationTotals.res1Pop = pRegionalCity->GetPopulation(0x1010);
-			currentCityPopulationTotals.res2Pop = pRegionalCity->GetPopulation(0x1020);
-			currentCityPopulationTotals.res3Pop = pRegionalCity->GetPopulation(0x1030);
-			currentCityPopulationTotals.cs1Pop = pRegionalCity->GetPopulation(0x3110);
-			currentCityPopulationTotals.cs2Pop = pRegionalCity->GetPopulation(0x3120);
-			currentCityPopulationTotals.cs3Pop = pRegionalCity->GetPopulation(0x3130);
-			currentCityPopulationTotals.co2Pop = pRegionalCity->GetPopulation(0x3320);
-			currentCityPopulationTotals.co3Pop = pRegionalCity->GetPopulation(0x3330);
-			currentCityPopulationTotals.irPop = pRegionalCity->GetPopulation(0x4100);
-			currentCityPopulationTotals.idPop = pRegionalCity->GetPopulation(0x4200);
-			currentCityPopulationTotals.imPop = pRegionalCity->GetPopulation(0x4300);
-			currentCityPopulationTotals.ihtPop = pRegionalCity->GetPopulation(0x4400);
+			ReadPopulationTotals(pRegionalCity, currentCityPopulationTotals);
 		}
 	}
 }
 
-void RegionalCityDataProvider::UpdateRegionalCityPopulationTotals()
+void RegionalCityDataProvider::UpdateCurrentCityEconomy()
 {
 	cISC4AppPtr pSC4App;
 
 	if (pSC4App)
 	{
-		cISC4Region* pRegion = pSC4App->GetRegion();
 		cISC4RegionalCity* pRegionalCity = pSC4App->GetRegionalCity();
 
-		if (pRegion && pRegionalCity)
+		if (pRegionalCity)
 		{
-			int32_t currentCityX = 0;
-			int32_t currentCityZ = 0;
+			RegionalCityKey key{};
+			key.population = pRegionalCity->GetPopulation();
+			key.commercialJobs = pRegionalCity->GetCommercialJobs();
+			key.industrialJobs = pRegionalCity->GetIndustrialJobs();
+
+			currentCityEstablished = pRegionalCity->GetEstablished();
+			ReadRegionalCityEconomy(pRegionalCity, key, currentCityEconomy);
+		}
+	}
+}
+
+void RegionalCityDataProvider::UpdateRegionalCityPopulationTotals()
+{
+	if (CaptureRegionalCities())
+	{
+		ApplyRegionScan(scanState);
+		PublishRegionScan();
+	}
+	else
+	{
+		UpdateRegionPopulationTotals();
+	}
+}
+
+bool RegionalCityDataProvider::CaptureRegionalCities()
+{
+	INSTRUMENT_SCOPE(InstrumentedCallSite::RegionScanCapture);
+
+	cISC4AppPtr pSC4App;
+
+	if (!pSC4App)
+	{
+		return false;
+	}
+
+	cISC4Region* pRegion = pSC4App->GetRegion();
+	cISC4RegionalCity* pRegionalCity = pSC4App->GetRegionalCity();
+
+	if (!pRegion || !pRegionalCity)
+	{
+		return false;
+	}
+
+	const char* const directoryName = pRegion->GetDirectoryName();
+
+	if (!directoryName || regionDirectory != directoryName)
+	{
+		// The snapshots belong to the cities of the previous region.
+		regionDirectory = directoryName ? directoryName : "";
+		scanState.snapshots.clear();
+		scanState.regionalTotals = {};
+	}
+
+	int32_t currentCityX = 0;
+	int32_t currentCityZ = 0;
+
+	pRegionalCity->GetPosition(currentCityX, currentCityZ);
 
-			pRegionalCity->GetPosition(currentCityX, currentCityZ);
+	scanState.currentCityFootprint = RegionCityFootprint{ static_cast<uint32_t>(currentCityX), static_cast<uint32_t>(currentCityZ), 1 };
 
-			eastl::vector<cISC4Region::cLocation> cityLocations;
+	eastl::vector<cISC4Region::cLocation> cityLocations;
 
-			pRegion->GetCityLocations(cityLocations);
+	pRegion->GetCityLocations(cityLocations);
 
-			size_t count = cityLocations.size();
+	std::vector<CapturedRegionalCity>& cities = scanState.cities;
+	cities.clear();
+	cities.reserve(cityLocations.size());
 
-			if (count > 0)
+	for (const cISC4Region::cLocation& location : cityLocations)
+	{
+		if (location.x == static_cast<uint32_t>(currentCityX) && location.z == static_cast<uint32_t>(currentCityZ))
+		{
+			// The current city values are handled separately.
+			scanState.currentCityFootprint = RegionCityFootprint{ location.x, location.z, GetCitySize(location.cityTileSize) };
+			continue;
+		}
+
+		// The city pointer should not be released.
+
+		cISC4RegionalCity** ppRegionalCity = pRegion->GetCity(location.x, location.z);
+
+		if (ppRegionalCity && *ppRegionalCity)
+		{
+			cISC4RegionalCity* pRegionalCity = *ppRegionalCity;
+
+			CapturedRegionalCity& city = cities.emplace_back();
+			city.positionKey = MakePositionKey(location.x, location.z);
+			city.size = GetCitySize(location.cityTileSize);
+			city.key.serialNumber = pRegionalCity->GetCitySerialNumber();
+			city.key.birthDate = pRegionalCity->GetBirthDate();
+			city.key.established = pRegionalCity->GetEstablished();
+
+			if (city.key.established)
 			{
-				for (size_t i = 0; i < count; i++)
+				city.key.population = pRegionalCity->GetPopulation();
+				city.key.commercialJobs = pRegionalCity->GetCommercialJobs();
+				city.key.industrialJobs = pRegionalCity->GetIndustrialJobs();
+				ReadRegionalCityEconomy(pRegionalCity, city.key, city.economy);
+			}
+
+			const auto snapshot = scanState.snapshots.find(city.positionKey);
+
+			// The 12 subgroup populations are only read when the key changed.
+			const bool keyChanged = snapshot == scanState.snapshots.end() || snapshot->second.key != city.key;
+
+			if (keyChanged)
+			{
+				if (city.key.established)
 				{
-					const cISC4Region::cLocation& location = cityLocations[i];
-
-					if (location.x == currentCityX && location.z == currentCityZ)
-					{
-						// The current city values are handled separately.
-						continue;
-					}
-
-					// The city pointer should not be released.
-
-					cISC4RegionalCity** ppRegionalCity = pRegion->GetCity(location.x, location.z);
-
-					if (ppRegionalCity && *ppRegionalCity)
-					{
-						cISC4RegionalCity* pRegionalCity = *ppRegionalCity;
-
-						if (pRegionalCity->GetEstablished())
-						{
-							regionalCityPopulationTotals.res1Pop += pRegionalCity->GetPopulation(0x1010);
-							regionalCityPopulationTotals.res2Pop += pRegionalCity->GetPopulation(0x1020);
-							regionalCityPopulationTotals.res3Pop += pRegionalCity->GetPopulation(0x1030);
-							regionalCityPopulationTotals.cs1Pop += pRegionalCity->GetPopulation(0x3110);
-							regionalCityPopulationTotals.cs2Pop += pRegionalCity->GetPopulation(0x3120);
-							regionalCityPopulationTotals.cs3Pop += pRegionalCity->GetPopulation(0x3130);
-							regionalCityPopulationTotals.co2Pop += pRegionalCity->GetPopulation(0x3320);
-							regionalCityPopulationTotals.co3Pop += pRegionalCity->GetPopulation(0x3330);
-							regionalCityPopulationTotals.irPop += pRegionalCity->GetPopulation(0x4100);
-							regionalCityPopulationTotals.idPop += pRegionalCity->GetPopulation(0x4200);
-							regionalCityPopulationTotals.imPop += pRegionalCity->GetPopulation(0x4300);
-							regionalCityPopulationTotals.ihtPop += pRegionalCity->GetPopulation(0x4400);
-						}
-					}
+					ReadPopulationTotals(pRegionalCity, city.totals);
 				}
 			}
+			else
+			{
+				city.totals = snapshot->second.totals;
+			}
+
+			city.changed = keyChanged || snapshot->second.economy != city.economy;
 		}
 	}
+
+	return true;
+}
+
+void RegionalCityDataProvider::ApplyRegionScan(RegionScanState& state)
+{
+	INSTRUMENT_SCOPE(InstrumentedCallSite::RegionScanApply);
+
+	state.scanGeneration++;
+	state.changedCityCount = 0;
+	state.removedCityCount = 0;
+
+	for (const CapturedRegionalCity& city : state.cities)
+	{
+		auto [it, inserted] = state.snapshots.try_emplace(city.positionKey, RegionalCitySnapshot{});
+
+		RegionalCitySnapshot& snapshot = it->second;
+
+		if (city.changed)
+		{
+			// Replace the city's previous contribution to the regional totals.
+			state.regionalTotals -= snapshot.totals;
+
+			snapshot.key = city.key;
+			snapshot.totals = city.totals;
+			snapshot.economy = city.economy;
+
+			state.regionalTotals += snapshot.totals;
+			state.changedCityCount++;
+		}
+
+		snapshot.scanGeneration = state.scanGeneration;
+		snapshot.size = city.size;
+	}
+
+	// Remove the cities that are no longer in the region, this also removes the
+	// snapshot for the current city when it was previously loaded as a regional city.
+	for (auto it = state.snapshots.begin(); it != state.snapshots.end();)
+	{
+		if (it->second.scanGeneration != state.scanGeneration)
+		{
+			state.regionalTotals -= it->second.totals;
+			it = state.snapshots.erase(it);
+			state.removedCityCount++;
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	state.cities.clear();
+
+	std::vector<RegionSpatialIndex::City> indexCities;
+	indexCities.reserve(state.snapshots.size());
+
+	for (const auto& item : state.snapshots)
+	{
+		const RegionCityFootprint footprint
+		{
+			static_cast<uint32_t>(item.first >> 32),
+			static_cast<uint32_t>(item.first),
+			item.second.size
+		};
+
+		indexCities.push_back(RegionSpatialIndex::City{ footprint, item.second.totals });
+	}
+
+	state.spatialIndex.Build(indexCities);
+
+	state.economyTable.Clear();
+	state.economyTable.Reserve(state.snapshots.size());
+
+	for (const auto& item : state.snapshots)
+	{
+		if (item.second.key.established)
+		{
+			state.economyTable.AddCity(item.second.economy);
+		}
+	}
+
+	state.economySummary = state.economyTable.Summarize();
+}
+
+void RegionalCityDataProvider::PublishRegionScan()
+{
+	UpdateRegionPopulationTotals();
+
+	LOG_WRITE_LINE(
+		LogLevel::Debug,
+		"Updated {} of {} regional cities, removed {}.",
+		scanState.changedCityCount,
+		scanState.snapshots.size(),
+		scanState.removedCityCount);
 }
@@ -11,22 +11,33 @@
 //////////////////////////////////////////////////////////////////////////
 
 #pragma once
+#include "PopulationTotals.h"
+#include "RegionEconomyTable.h"
+#include "RegionSpatialIndex.h"
 #include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
-struct PopulationTotals
+class cISC4RegionalCity;
+
+/**
+ * @brief The values that identify a regional city and its total population and jobs.
+ *
+ * The city's 12 subgroup populations are only read when its key changes. A city that
+ * moves population between its subgroups without changing its total population or
+ * job counts keeps its previous subgroup values until the key changes.
+ */
+struct RegionalCityKey
 {
-	int64_t res1Pop;
-	int64_t res2Pop;
-	int64_t res3Pop;
-	int64_t cs1Pop;
-	int64_t cs2Pop;
-	int64_t cs3Pop;
-	int64_t co2Pop;
-	int64_t co3Pop;
-	int64_t irPop;
-	int64_t idPop;
-	int64_t imPop;
-	int64_t ihtPop;
+	uint32_t serialNumber;
+	uint32_t birthDate;
+	bool established;
+	int32_t population;
+	int32_t commercialJobs;
+	int32_t industrialJobs;
+
+	bool operator==(const RegionalCityKey& other) const = default;
 };
 
 class RegionalCityDataProvider
@@ -36,18 +47,82 @@ public:
 
 	const PopulationTotals& GetRegionTotalPopulation() const;
 
+	/**
+	 * @brief Gets the total population of the regional cities near the current city.
+	 * @param distance The distance in small city tiles, a distance of 1 includes the adjacent cities.
+	 */
+	PopulationTotals GetNearbyPopulation(uint32_t distance) const;
+
+	/**
+	 * @brief Gets the region statistics of the established cities' economy values,
+	 * including the current city.
+	 */
+	const RegionEconomySummary& GetRegionEconomySummary() const;
+
 	void PostCityInit();
 
 	void PostSave();
 
 private:
+	struct RegionalCitySnapshot
+	{
+		RegionalCityKey key;
+		PopulationTotals totals;
+		uint32_t scanGeneration;
+		// The city size in small city tiles.
+		uint32_t size;
+		RegionalCityEconomy economy;
+	};
+
+	// The values that were read from a regional city.
+	struct CapturedRegionalCity
+	{
+		uint64_t positionKey;
+		uint32_t size;
+		RegionalCityKey key;
+		PopulationTotals totals;
+		RegionalCityEconomy economy;
+		// True if the key or the economy values differ from the city's snapshot.
+		bool changed;
+	};
+
+	// The values that are kept between the region scans.
+	struct RegionScanState
+	{
+		std::vector<CapturedRegionalCity> cities;
+		// The snapshots are keyed by the city tile position.
+		std::unordered_map<uint64_t, RegionalCitySnapshot> snapshots;
+		PopulationTotals regionalTotals;
+		// The index of the regional city populations, it is rebuilt after each scan.
+		RegionSpatialIndex spatialIndex;
+		RegionCityFootprint currentCityFootprint;
+		// The table and its summary are rebuilt after each scan.
+		RegionEconomyTable economyTable;
+		RegionEconomySummary economySummary;
+		uint32_t scanGeneration;
+		uint32_t changedCityCount;
+		uint32_t removedCityCount;
+	};
+
+	static void ApplyRegionScan(RegionScanState& state);
+
 	void UpdateRegionPopulationTotals();
 
 	void UpdateCurrentCityPopulationTotals();
 
+	void UpdateCurrentCityEconomy();
+
 	void UpdateRegionalCityPopulationTotals();
 
+	bool CaptureRegionalCities();
+
+	void PublishRegionScan();
+
+	RegionScanState scanState;
+	std::string regionDirectory;
 	PopulationTotals regionPopulationTotals;
 	PopulationTotals currentCityPopulationTotals;
-	PopulationTotals regionalCityPopulationTotals;
+	RegionEconomySummary regionEconomySummary;
+	RegionalCityEconomy currentCityEconomy;
+	bool currentCityEstablished;
 };
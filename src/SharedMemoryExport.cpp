@@ -0,0 +1,165 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "SharedMemoryExport.h"
+#include <cstring>
+#include <new>
+#include <string>
+#include <Windows.h>
+#include "wil/resource.h"
+
+namespace
+{
+	constexpr size_t kHeaderSize = sizeof(SharedMemoryExportHeader);
+	constexpr size_t kDataSize = sizeof(cISC4MoreDemandInfoData);
+
+	constexpr int kMaxReadAttempts = 64;
+}
+
+SharedMemoryExport::SharedMemoryExport()
+	: mappingHandle(nullptr),
+	  pView(nullptr),
+	  pHeader(nullptr),
+	  pData(nullptr),
+	  lastGeneration(0),
+	  hasWritten(false)
+{
+}
+
+bool SharedMemoryExport::Open()
+{
+	Close();
+
+	// The Local namespace makes the object visible to the processes in the current session.
+	std::string objectName("Local\\");
+	objectName += SharedMemoryExportName;
+
+	wil::unique_handle mapping(CreateFileMappingA(
+		INVALID_HANDLE_VALUE,
+		nullptr,
+		PAGE_READWRITE,
+		0,
+		static_cast<DWORD>(kHeaderSize + kDataSize),
+		objectName.c_str()));
+
+	if (!mapping)
+	{
+		return false;
+	}
+
+	uint8_t* const data = static_cast<uint8_t*>(MapViewOfFile(
+		mapping.get(),
+		FILE_MAP_WRITE,
+		0,
+		0,
+		kHeaderSize + kDataSize));
+
+	if (!data)
+	{
+		return false;
+	}
+
+	mappingHandle = mapping.release();
+	pView = data;
+
+	// The sequence starts at zero, a reader treats the data as valid once the
+	// first write advances it to an even non-zero value.
+	pHeader = new (data) SharedMemoryExportHeader{};
+	pHeader->signature = kSharedMemoryExportSignature;
+	pHeader->version = kSharedMemoryExportVersion;
+	pHeader->headerSize = static_cast<uint32_t>(kHeaderSize);
+	pHeader->dataSize = static_cast<uint32_t>(kDataSize);
+	pData = data + kHeaderSize;
+	hasWritten = false;
+
+	return true;
+}
+
+void SharedMemoryExport::Close()
+{
+	if (pView)
+	{
+		UnmapViewOfFile(pView);
+		CloseHandle(mappingHandle);
+		pView = nullptr;
+		mappingHandle = nullptr;
+	}
+
+	pHeader = nullptr;
+	pData = nullptr;
+	hasWritten = false;
+}
+
+bool SharedMemoryExport::IsOpen() const
+{
+	return pHeader != nullptr;
+}
+
+void SharedMemoryExport::Write(const cISC4MoreDemandInfo& info)
+{
+	const uint32_t generation = info.GetGeneration();
+
+	if (!pHeader || (hasWritten && generation == lastGeneration))
+	{
+		return;
+	}
+
+	const uint32_t sequence = pHeader->sequence.load(std::memory_order_relaxed);
+
+	pHeader->sequence.store(sequence + 1, std::memory_order_relaxed);
+	// The odd sequence must be visible before any of the data changes.
+	std::atomic_thread_fence(std::memory_order_release);
+
+	std::memcpy(pData, info.GetData(), kDataSize);
+	pHeader->generation = generation;
+
+	pHeader->sequence.store(sequence + 2, std::memory_order_release);
+
+	lastGeneration = generation;
+	hasWritten = true;
+}
+
+bool SharedMemoryExport::Read(const uint8_t* view, cISC4MoreDemandInfoData& data, uint32_t& generation)
+{
+	const SharedMemoryExportHeader* header = reinterpret_cast<const SharedMemoryExportHeader*>(view);
+
+	if (header->signature != kSharedMemoryExportSignature
+		|| header->version != kSharedMemoryExportVersion
+		|| header->headerSize != kHeaderSize
+		|| header->dataSize != kDataSize)
+	{
+		return false;
+	}
+
+	for (int i = 0; i < kMaxReadAttempts; i++)
+	{
+		const uint32_t before = header->sequence.load(std::memory_order_acquire);
+
+		if (before == 0 || (before & 1) != 0)
+		{
+			continue;
+		}
+
+		std::memcpy(&data, view + kHeaderSize, kDataSize);
+		generation = header->generation;
+
+		// The copy must complete before the sequence is read again.
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		if (header->sequence.load(std::memory_order_relaxed) == before)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
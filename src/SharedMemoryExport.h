@@ -0,0 +1,80 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "cISC4MoreDemandInfo.h"
+#include <atomic>
+#include <cstdint>
+
+// The shared memory starts with a SharedMemoryExportHeader that is followed by a
+// cISC4MoreDemandInfoData structure, at an offset of headerSize bytes.
+//
+// The writer increments the sequence number before and after it copies the data, so
+// the sequence is odd while a write is in progress. A reader copies the data and
+// checks that the sequence was even and did not change during the copy, otherwise
+// it must retry. The readers never block the writer.
+
+inline constexpr const char* SharedMemoryExportName = "SC4MoreDemandInfo";
+
+inline constexpr uint32_t kSharedMemoryExportSignature = 0x4D53444D; // MDSM
+inline constexpr uint32_t kSharedMemoryExportVersion = 1;
+
+struct SharedMemoryExportHeader
+{
+	uint32_t signature;
+	uint32_t version;
+	uint32_t headerSize;
+	uint32_t dataSize;
+	std::atomic<uint32_t> sequence;
+	// The cISC4MoreDemandInfo generation of the data.
+	uint32_t generation;
+};
+
+static_assert(sizeof(SharedMemoryExportHeader) == 24);
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+class SharedMemoryExport
+{
+public:
+	SharedMemoryExport();
+
+	bool Open();
+
+	void Close();
+
+	bool IsOpen() const;
+
+	/**
+	 * @brief Copies the interface's data to the shared memory if its generation changed.
+	 */
+	void Write(const cISC4MoreDemandInfo& info);
+
+	/**
+	 * @brief Reads a consistent copy of the data from a mapped export.
+	 * @param view The start of the shared memory.
+	 * @param data Receives the data.
+	 * @param generation Receives the generation of the data.
+	 * @return True if the data was read; otherwise, false if the layout does not match
+	 * or the writer was updating the data on every attempt.
+	 */
+	static bool Read(const uint8_t* view, cISC4MoreDemandInfoData& data, uint32_t& generation);
+
+private:
+	// The file mapping handle, the name of the object is removed when its
+	// last handle is closed.
+	void* mappingHandle;
+	uint8_t* pView;
+	SharedMemoryExportHeader* pHeader;
+	uint8_t* pData;
+	uint32_t lastGeneration;
+	bool hasWritten;
+};
@@ -0,0 +1,106 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "SimulatorTickAgent.h"
+#include "cISC4Simulator.h"
+#include "cRZBaseString.h"
+#include "GZCLSIDDefs.h"
+#include <utility>
+
+// The simulator only accepts agent types in the range of [0, 10].
+// The meaning of the individual agent types is unknown, type 0 is assumed to be called
+// once per simulation step. The plugin does not depend on that assumption, it stops using
+// the agent when the demand change messages arrive without ticks.
+static constexpr uint32_t kSimulatorAgentType = 0;
+
+static constexpr const char* kSimulatorAgentName = "SC4MoreDemandInfo";
+
+SimulatorTickAgent::SimulatorTickAgent(std::function<void()> tickCallback)
+	: tickCallback(std::move(tickCallback)),
+	  pSimulator(nullptr),
+	  refCount(0)
+{
+}
+
+bool SimulatorTickAgent::QueryInterface(uint32_t riid, void** ppvObj)
+{
+	if (riid == GZCLSID::kcIGZMessageTarget2)
+	{
+		*ppvObj = static_cast<cIGZMessageTarget2*>(this);
+		AddRef();
+
+		return true;
+	}
+	else if (riid == GZIID_cIGZUnknown)
+	{
+		*ppvObj = static_cast<cIGZUnknown*>(this);
+		AddRef();
+
+		return true;
+	}
+
+	return false;
+}
+
+uint32_t SimulatorTickAgent::AddRef()
+{
+	return ++refCount;
+}
+
+uint32_t SimulatorTickAgent::Release()
+{
+	if (refCount > 0)
+	{
+		--refCount;
+	}
+
+	return refCount;
+}
+
+bool SimulatorTickAgent::DoMessage(cIGZMessage2* pMessage)
+{
+	// The message types that the simulator sends to its agents are not documented,
+	// so every message is treated as a tick.
+	tickCallback();
+	return true;
+}
+
+bool SimulatorTickAgent::Register(cISC4Simulator* pSimulator)
+{
+	Unregister();
+
+	if (pSimulator)
+	{
+		cRZBaseString name(kSimulatorAgentName);
+
+		if (pSimulator->AddAgent(this, kSimulatorAgentType, name, 0))
+		{
+			this->pSimulator = pSimulator;
+		}
+	}
+
+	return this->pSimulator != nullptr;
+}
+
+void SimulatorTickAgent::Unregister()
+{
+	if (pSimulator)
+	{
+		pSimulator->RemoveAgent(this);
+		pSimulator = nullptr;
+	}
+}
+
+bool SimulatorTickAgent::IsRegistered() const
+{
+	return pSimulator != nullptr;
+}
@@ -0,0 +1,45 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "cIGZMessageTarget2.h"
+#include <functional>
+
+class cISC4Simulator;
+
+/**
+ * @brief A simulator agent that calls a function once per simulation tick.
+ */
+class SimulatorTickAgent final : public cIGZMessageTarget2
+{
+public:
+	explicit SimulatorTickAgent(std::function<void()> tickCallback);
+
+	bool QueryInterface(uint32_t riid, void** ppvObj) override;
+
+	uint32_t AddRef() override;
+
+	uint32_t Release() override;
+
+	bool DoMessage(cIGZMessage2* pMessage) override;
+
+	bool Register(cISC4Simulator* pSimulator);
+
+	void Unregister();
+
+	bool IsRegistered() const;
+
+private:
+	std::function<void()> tickCallback;
+	cISC4Simulator* pSimulator;
+	uint32_t refCount;
+};
@@ -0,0 +1,65 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// LEB128 variable-length integers, the signed values are zigzag encoded so that
+// small negative deltas also use few bytes.
+namespace VarintEncoding
+{
+	constexpr uint64_t ZigZagEncode(int64_t value)
+	{
+		return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+	}
+
+	constexpr int64_t ZigZagDecode(uint64_t value)
+	{
+		return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+	}
+
+	inline void Write(std::vector<uint8_t>& buffer, uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			buffer.push_back(static_cast<uint8_t>(value | 0x80));
+			value >>= 7;
+		}
+
+		buffer.push_back(static_cast<uint8_t>(value));
+	}
+
+	inline bool Read(const uint8_t* data, size_t dataLength, size_t& position, uint64_t& value)
+	{
+		value = 0;
+
+		for (uint32_t shift = 0; shift < 64; shift += 7)
+		{
+			if (position >= dataLength)
+			{
+				return false;
+			}
+
+			const uint8_t byte = data[position++];
+			value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+
+			if ((byte & 0x80) == 0)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+}
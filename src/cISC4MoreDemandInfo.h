@@ -0,0 +1,89 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-more-demand-info, a DLL Plugin for SimCity 4
+// that provides more game variables with RCI demand information.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "cIGZUnknown.h"
+#include <cstdint>
+
+// Other DLL plugins can get the interface from the game's COM system:
+//
+// cISC4MoreDemandInfo* pMoreDemandInfo = nullptr;
+// if (RZGetFrameWork()->GetCOMObject()->GetClassObject(
+//		GZCLSID_cISC4MoreDemandInfo,
+//		GZIID_cISC4MoreDemandInfo,
+//		reinterpret_cast<void**>(&pMoreDemandInfo)))
+// {
+//		...
+//		pMoreDemandInfo->Release();
+// }
+
+static const uint32_t GZIID_cISC4MoreDemandInfo = 0x4B5D7A21;
+static const uint32_t GZCLSID_cISC4MoreDemandInfo = 0x9E06B680;
+
+struct cISC4MoreDemandInfoDemandGroup
+{
+	// The cISC4Demand ID, e.g. 0x1010 for R§.
+	uint32_t demandID;
+	float activeDemand;
+	float demand;
+	// The demand cap in the range of [0, 1], this is only set for IR (I-Ag).
+	float demandCap;
+};
+
+/**
+ * @brief The plugin's latest values. New fields are only added at the end of
+ * the structure, consumers should check the size before reading them.
+ */
+struct cISC4MoreDemandInfoData
+{
+	// The size of this structure in bytes.
+	uint32_t size;
+	// Non-zero when a city is loaded.
+	uint32_t cityLoaded;
+	// The simulator date of the last monthly update.
+	int32_t simDate;
+	// A bit set of the demandGroups entries that have values.
+	uint32_t validDemandGroups;
+	// R§, R§§, R§§§, Cs§, Cs§§, Cs§§§, Co§§, Co§§§, IR (I-Ag), ID, IM and IHT.
+	cISC4MoreDemandInfoDemandGroup demandGroups[12];
+	// The estimated monthly tax income in the order of the g_tax_income_* variables.
+	int64_t taxIncome[12];
+	// The average tax income over the last 12 months, in the same order as taxIncome.
+	double taxIncomeAverage[12];
+	// The region and nearby city populations in the same order as demandGroups.
+	int64_t regionPopulation[12];
+	int64_t nearbyPopulation[12];
+};
+
+/**
+ * @brief Provides read-only access to the values that SC4MoreDemandInfo publishes.
+ *
+ * The values are updated on the game's main thread, the interface must only be
+ * used from that thread.
+ */
+class cISC4MoreDemandInfo : public cIGZUnknown
+{
+public:
+	/**
+	 * @brief Gets a number that changes whenever the plugin updates its values.
+	 *
+	 * Consumers can store the generation and skip their own work when it has
+	 * not changed since the last call.
+	 */
+	virtual uint32_t GetGeneration() const = 0;
+
+	/**
+	 * @brief Gets the plugin's latest values.
+	 * @return A pointer to the values, it remains valid until the game exits.
+	 */
+	virtual const cISC4MoreDemandInfoData* GetData() const = 0;
+};